@@ -3,6 +3,7 @@
 #include "qtexttospeech_android.h"
 
 #include <QtCore/qcoreapplication.h>
+#include <QtCore/qhash.h>
 #include <QtCore/qoperatingsystemversion.h>
 
 QT_BEGIN_NAMESPACE
@@ -488,6 +489,24 @@ QList<QVoice> QTextToSpeechEngineAndroid::availableVoices() const
     return result;
 }
 
+QList<QVoice> QTextToSpeechEngineAndroid::allVoices() const
+{
+    auto voices = m_speech.callObjectMethod("getAvailableVoices", "()Ljava/util/List;");
+    int count = voices.callMethod<jint>("size");
+    QHash<QLocale, QList<QVoice>> voicesByLocale;
+    for (int i = 0; i < count; ++i) {
+        auto jvoice = voices.callMethod<jobject>("get", i);
+        const QVoice voice = javaVoiceObjectToQVoice(jvoice);
+        voicesByLocale[voice.locale()] << voice;
+    }
+    QList<QVoice> result;
+    result.reserve(count);
+    const QList<QLocale> locales = availableLocales();
+    for (const QLocale &locale : locales)
+        result << voicesByLocale.value(locale);
+    return result;
+}
+
 bool QTextToSpeechEngineAndroid::setVoice(const QVoice &voice)
 {
     const QString id = voiceData(voice).toString();
@@ -27,6 +27,7 @@ public:
     QTextToSpeech::Capabilities capabilities() const override;
     QList<QLocale> availableLocales() const override;
     QList<QVoice> availableVoices() const override;
+    QList<QVoice> allVoices() const override;
     void say(const QString &text) override;
     void synthesize(const QString &text) override;
     void stop(QTextToSpeech::BoundaryHint boundaryHint) override;
@@ -347,6 +347,21 @@ QList<QVoice> QTextToSpeechEngineDarwin::availableVoices() const
     return voices;
 }
 
+QList<QVoice> QTextToSpeechEngineDarwin::allVoices() const
+{
+    QHash<QLocale, QList<QVoice>> voicesByLocale;
+    for (AVSpeechSynthesisVoice *avVoice in [AVSpeechSynthesisVoice speechVoices]) {
+        const QLocale voiceLocale(QString::fromNSString(avVoice.language));
+        voicesByLocale[voiceLocale] << toQVoice(avVoice);
+    }
+
+    QList<QVoice> voices;
+    const QList<QLocale> locales = availableLocales();
+    for (const QLocale &locale : locales)
+        voices << voicesByLocale.value(locale);
+    return voices;
+}
+
 bool QTextToSpeechEngineDarwin::setVoice(const QVoice &voice)
 {
     AVSpeechSynthesisVoice *avVoice = fromQVoice(voice);
@@ -11,6 +11,35 @@ using namespace Qt::StringLiterals;
 
 QTextToSpeechEngineFlite::QTextToSpeechEngineFlite(const QVariantMap &parameters, QObject *parent)
     : QTextToSpeechEngine(parent)
+{
+    // Discovering the voices is what takes long, and works on any thread
+    const QList<QTextToSpeechProcessorFlite::VoiceInfo> voices =
+            QTextToSpeechProcessorFlite::discoverVoices();
+    for (const QTextToSpeechProcessorFlite::VoiceInfo &voiceInfo : voices) {
+        const QLocale locale(voiceInfo.locale);
+        const QVoice voice = QTextToSpeechEngine::createVoice(voiceInfo.name, locale,
+                                                              voiceInfo.gender, voiceInfo.age,
+                                                              QVariant(voiceInfo.id));
+        // Use the first available locale/voice as a fallback
+        if (m_voices.isEmpty())
+            m_voice = voice;
+        m_voices.insert(locale, voice);
+    }
+
+    // QTextToSpeech constructs the engine on a worker thread with this parameter,
+    // and moves it to its own thread afterwards, together with the queued call,
+    // which then runs before QTextToSpeech takes the engine over. The threads,
+    // the processors and the audio device have to belong to that thread.
+    if (parameters.value("initializeAsynchronously"_L1).toBool()) {
+        QMetaObject::invokeMethod(this, [this, parameters]{
+            startProcessing(parameters);
+        }, Qt::QueuedConnection);
+    } else {
+        startProcessing(parameters);
+    }
+}
+
+void QTextToSpeechEngineFlite::startProcessing(const QVariantMap &parameters)
 {
     QAudioDevice audioDevice;
     if (const auto it = parameters.find("audioDevice"_L1); it != parameters.end())
@@ -33,27 +62,82 @@ QTextToSpeechEngineFlite::QTextToSpeechEngineFlite(const QVariantMap &parameters
             &QTextToSpeechEngine::sayingWord);
     connect(m_processor.get(), &QTextToSpeechProcessorFlite::synthesized, this,
             &QTextToSpeechEngine::synthesized);
+    connect(m_processor.get(), &QTextToSpeechProcessorFlite::audioWritten, this,
+            &QTextToSpeechEngine::audioWritten);
 
-    // Read voices from processor before moving it to a separate thread
-    const QList<QTextToSpeechProcessorFlite::VoiceInfo> voices = m_processor->voices();
-
-    int voiceIndex = 0;
-    for (const QTextToSpeechProcessorFlite::VoiceInfo &voiceInfo : voices) {
-        const QLocale locale(voiceInfo.locale);
-        const QVoice voice = QTextToSpeechEngine::createVoice(voiceInfo.name, locale,
-                                                              voiceInfo.gender, voiceInfo.age,
-                                                              QVariant(voiceInfo.id));
-        m_voices.insert(locale, voice);
-        // Use the first available locale/voice as a fallback
-        if (voiceIndex == 0)
-            m_voice = voice;
-        ++voiceIndex;
-    }
-
-    if (voiceIndex) {
+    if (!m_voices.isEmpty()) {
         m_state = QTextToSpeech::Ready;
-        m_processor->moveToThread(&m_thread);
-        m_thread.start();
+
+        // With more than one synthesis thread, texts passed to synthesize() get
+        // split into sentences that are processed in parallel. Batches are always
+        // processed that way, even with a single thread.
+        int synthesisThreads = parameters.value("synthesisThreads"_L1, 1).toInt();
+        if (synthesisThreads <= 0)
+            synthesisThreads = QThread::idealThreadCount();
+        // With a limit for the synthesized data that has not been delivered yet,
+        // synthesis threads wait for slow receivers of the synthesized() signal.
+        if (const qint64 maxPendingBytes = parameters.value("maxPendingBytes"_L1).toLongLong();
+            maxPendingBytes > 0) {
+            m_flowControl = std::make_unique<QTextToSpeechFliteFlowControl>(maxPendingBytes);
+        }
+        // Voices get registered when they are first used, and optionally
+        // unregistered again once they have not been used for a while.
+        const int voiceIdleTimeout = parameters.value("voiceIdleTimeout"_L1).toInt();
+        m_processor->setVoiceIdleTimeout(voiceIdleTimeout);
+        // Synthesized data gets converted into the format requested by the application
+        const QAudioFormat synthesisFormat = parameters.value("synthesisFormat"_L1)
+                                                       .value<QAudioFormat>();
+        m_processor->setSynthesisFormat(synthesisFormat);
+        // Each processor processes its data with its own copy of the chain
+        const QTextToSpeechProcessingChain processingChain =
+                parameters.value("processingChain"_L1).value<QTextToSpeechProcessingChain>();
+        m_processor->setProcessingChain(processingChain);
+        const auto connectSegmentSignals = [this](QTextToSpeechProcessorFlite *processor) {
+            connect(processor, &QTextToSpeechProcessorFlite::segmentSynthesized,
+                    this, &QTextToSpeechEngineFlite::segmentSynthesized);
+            connect(processor, &QTextToSpeechProcessorFlite::segmentWord,
+                    this, &QTextToSpeechEngineFlite::segmentWord);
+            connect(processor, &QTextToSpeechProcessorFlite::segmentFinished,
+                    this, &QTextToSpeechEngineFlite::segmentFinished);
+        };
+        for (int i = 1; i < synthesisThreads; ++i) {
+            SynthesisWorker worker{std::make_unique<QThread>(),
+                                   std::make_unique<QTextToSpeechProcessorFlite>(audioDevice)};
+            worker.processor->setFlowControl(m_flowControl.get());
+            worker.processor->setVoiceIdleTimeout(voiceIdleTimeout);
+            worker.processor->setSynthesisFormat(synthesisFormat);
+            worker.processor->setProcessingChain(processingChain);
+            connect(worker.processor.get(), &QTextToSpeechProcessorFlite::errorOccurred,
+                    this, &QTextToSpeechEngineFlite::setError);
+            connectSegmentSignals(worker.processor.get());
+            worker.processor->moveToThread(worker.thread.get());
+            worker.thread->start();
+            m_synthesisWorkers.push_back(std::move(worker));
+        }
+        // With look-ahead, the next texts in the queue get synthesized in a
+        // separate thread while the current text is spoken.
+        m_lookAhead = qMax(parameters.value("lookAhead"_L1).toLongLong(), 0ll);
+        if (m_lookAhead) {
+            m_lookAheadWorker.thread = std::make_unique<QThread>();
+            m_lookAheadWorker.processor = std::make_unique<QTextToSpeechProcessorFlite>(audioDevice);
+            m_lookAheadWorker.processor->setVoiceIdleTimeout(voiceIdleTimeout);
+            m_lookAheadWorker.processor->setProcessingChain(processingChain);
+            connect(m_lookAheadWorker.processor.get(), &QTextToSpeechProcessorFlite::prepared,
+                    this, &QTextToSpeechEngineFlite::textPrepared);
+            m_lookAheadWorker.processor->moveToThread(m_lookAheadWorker.thread.get());
+            m_lookAheadWorker.thread->start();
+        }
+        connectSegmentSignals(m_processor.get());
+        m_processor->setFlowControl(m_flowControl.get());
+        // Speak long texts sentence by sentence, so that playback starts
+        // once the first sentence has been synthesized.
+        m_processor->setSentenceStreaming(parameters.value("sentenceStreaming"_L1).toBool());
+        // The audio sink stays open between texts with the same audio format,
+        // optionally only until it has been idle for a while.
+        m_processor->setAudioIdleTimeout(parameters.value("audioIdleTimeout"_L1).toInt());
+        m_thread = std::make_unique<QThread>();
+        m_processor->moveToThread(m_thread.get());
+        m_thread->start();
     } else {
         m_errorReason = QTextToSpeech::ErrorReason::Configuration;
         m_errorString = QCoreApplication::translate("QTextToSpeech", "No voices available");
@@ -62,8 +146,19 @@ QTextToSpeechEngineFlite::QTextToSpeechEngineFlite(const QVariantMap &parameters
 
 QTextToSpeechEngineFlite::~QTextToSpeechEngineFlite()
 {
-    m_thread.exit();
-    m_thread.wait();
+    cancelSegments();
+    for (const SynthesisWorker &worker : m_synthesisWorkers)
+        worker.thread->exit();
+    if (m_lookAheadWorker.thread)
+        m_lookAheadWorker.thread->exit();
+    if (m_thread)
+        m_thread->exit();
+    for (const SynthesisWorker &worker : m_synthesisWorkers)
+        worker.thread->wait();
+    if (m_lookAheadWorker.thread)
+        m_lookAheadWorker.thread->wait();
+    if (m_thread)
+        m_thread->wait();
 }
 
 QList<QLocale> QTextToSpeechEngineFlite::availableLocales() const
@@ -76,8 +171,34 @@ QList<QVoice> QTextToSpeechEngineFlite::availableVoices() const
     return m_voices.values(m_voice.locale());
 }
 
+QList<QVoice> QTextToSpeechEngineFlite::allVoices() const
+{
+    QList<QVoice> voices;
+    voices.reserve(m_voices.size());
+    const QList<QLocale> locales = availableLocales();
+    for (const QLocale &locale : locales)
+        voices << m_voices.values(locale);
+    return voices;
+}
+
 void QTextToSpeechEngineFlite::say(const QString &text)
 {
+    const auto it = std::find_if(m_preparedTexts.begin(), m_preparedTexts.end(),
+                                 [this, &text](const auto &prepared) {
+        return prepared.finished && isPreparedFor(prepared, text);
+    });
+    if (it != m_preparedTexts.end()) {
+        const QTextToSpeechProcessorFlite::PreparedText prepared = std::move(*it);
+        m_preparedTexts.erase(it);
+        if (prepared.sampleRate) {
+            QMetaObject::invokeMethod(m_processor.get(), [processor = m_processor.get(),
+                                                          prepared, volume = m_volume]{
+                processor->sayPrepared(prepared, volume);
+            }, Qt::QueuedConnection);
+            return;
+        }
+    }
+
     QMetaObject::invokeMethod(m_processor.get(), "say", Qt::QueuedConnection, Q_ARG(QString, text),
                               Q_ARG(int, voiceData(voice()).toInt()), Q_ARG(double, pitch()),
                               Q_ARG(double, rate()), Q_ARG(double, volume()));
@@ -85,14 +206,111 @@ void QTextToSpeechEngineFlite::say(const QString &text)
 
 void QTextToSpeechEngineFlite::synthesize(const QString &text)
 {
+    if (!m_synthesisWorkers.empty() || m_flowControl) {
+        if (!QTextToSpeechProcessorFlite::splitSentences(text).isEmpty()) {
+            changeState(QTextToSpeech::Synthesizing);
+            synthesizeSegments(text, -1);
+        }
+        return;
+    }
+
     QMetaObject::invokeMethod(m_processor.get(), "synthesize", Qt::QueuedConnection, Q_ARG(QString, text),
                               Q_ARG(int, voiceData(voice()).toInt()), Q_ARG(double, pitch()),
                               Q_ARG(double, rate()), Q_ARG(double, volume()));
 }
 
+bool QTextToSpeechEngineFlite::synthesizeBatch(const QStringList &texts)
+{
+    if (m_state == QTextToSpeech::Error)
+        return false;
+
+    changeState(QTextToSpeech::Synthesizing);
+    for (qsizetype i = 0; i < texts.size(); ++i)
+        synthesizeSegments(texts.at(i), i);
+    return true;
+}
+
+void QTextToSpeechEngineFlite::prepare(const QStringList &texts)
+{
+    if (!m_lookAhead)
+        return;
+
+    const QStringList upcoming = texts.first(qMin(texts.size(), m_lookAhead));
+    // Forget texts that are no longer coming up, or that would sound different now.
+    // The results for texts that are still being synthesized get ignored.
+    m_preparedTexts.removeIf([this, &upcoming](const auto &prepared) {
+        return !upcoming.contains(prepared.text) || !isPreparedFor(prepared, prepared.text);
+    });
+
+    const int voiceId = voiceData(voice()).toInt();
+    for (const QString &text : upcoming) {
+        const bool known = std::any_of(m_preparedTexts.cbegin(), m_preparedTexts.cend(),
+                                       [&text](const auto &prepared) {
+            return prepared.text == text;
+        });
+        if (known)
+            continue;
+        m_preparedTexts.append({text, voiceId, m_pitch, m_rate});
+        QTextToSpeechProcessorFlite *processor = m_lookAheadWorker.processor.get();
+        QMetaObject::invokeMethod(processor, [processor, text, voiceId,
+                                              pitch = m_pitch, rate = m_rate]{
+            processor->prepare(text, voiceId, pitch, rate);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void QTextToSpeechEngineFlite::textPrepared(const QTextToSpeechProcessorFlite::PreparedText &prepared)
+{
+    const auto it = std::find_if(m_preparedTexts.begin(), m_preparedTexts.end(),
+                                 [&prepared](const auto &pending) {
+        return !pending.finished && pending.text == prepared.text
+            && pending.voiceId == prepared.voiceId
+            && pending.pitch == prepared.pitch && pending.rate == prepared.rate;
+    });
+    if (it != m_preparedTexts.end())
+        *it = prepared;
+}
+
+bool QTextToSpeechEngineFlite::isPreparedFor(const QTextToSpeechProcessorFlite::PreparedText &prepared,
+                                             const QString &text) const
+{
+    return prepared.text == text && prepared.voiceId == voiceData(voice()).toInt()
+        && prepared.pitch == m_pitch && prepared.rate == m_rate;
+}
+
+void QTextToSpeechEngineFlite::synthesizeSegments(const QString &text, qsizetype utterance)
+{
+    QList<QStringView> sentences = QTextToSpeechProcessorFlite::splitSentences(text);
+    // texts without anything to synthesize still need to complete
+    if (sentences.isEmpty())
+        sentences.append(QStringView());
+
+    const int voiceId = voiceData(voice()).toInt();
+    for (const QStringView &sentence : std::as_const(sentences)) {
+        const qsizetype segment = m_nextSegment++;
+        PendingSegment pendingSegment;
+        if (!sentence.isNull())
+            pendingSegment.textOffset = sentence.data() - text.data();
+        if (&sentence == &sentences.constLast())
+            pendingSegment.lastOfUtterance = utterance;
+        m_pendingSegments.insert(segment, pendingSegment);
+        QTextToSpeechProcessorFlite *processor = segmentProcessor(segment);
+        QMetaObject::invokeMethod(processor, [processor, segment, sentence = sentence.toString(),
+                                              voiceId, pitch = m_pitch, rate = m_rate,
+                                              volume = m_volume]{
+            processor->synthesizeSegment(segment, sentence, voiceId, pitch, rate, volume);
+        }, Qt::QueuedConnection);
+    }
+}
+
 void QTextToSpeechEngineFlite::stop(QTextToSpeech::BoundaryHint boundaryHint)
 {
     Q_UNUSED(boundaryHint);
+    if (!m_pendingSegments.isEmpty()) {
+        cancelSegments();
+        changeState(QTextToSpeech::Ready);
+        return;
+    }
     QMetaObject::invokeMethod(m_processor.get(), &QTextToSpeechProcessorFlite::stop, Qt::QueuedConnection);
 }
 
@@ -118,6 +336,8 @@ bool QTextToSpeechEngineFlite::setRate(double rate)
         return false;
 
     m_rate = rate;
+    // Applies to the text that is spoken, by stretching the synthesized data
+    m_processor->setPlaybackRate(rate);
     return true;
 }
 
@@ -206,10 +426,133 @@ QString QTextToSpeechEngineFlite::errorString() const
 
 void QTextToSpeechEngineFlite::setError(QTextToSpeech::ErrorReason error, const QString &errorString)
 {
+    cancelSegments();
     m_errorReason = error;
     m_errorString = errorString;
     changeState(QTextToSpeech::Error);
     emit errorOccurred(error, errorString);
 }
 
+QTextToSpeechProcessorFlite *QTextToSpeechEngineFlite::segmentProcessor(qsizetype segment) const
+{
+    const qsizetype index = segment % qsizetype(m_synthesisWorkers.size() + 1);
+    return index ? m_synthesisWorkers.at(index - 1).processor.get() : m_processor.get();
+}
+
+void QTextToSpeechEngineFlite::segmentSynthesized(qsizetype segment, const QAudioFormat &format,
+                                                  const QByteArray &data)
+{
+    // The data of the segment that is currently delivered can be passed on right
+    // away, later segments have to wait until all previous segments are done.
+    if (segment == m_currentSegment) {
+        emit synthesized(format, data);
+        if (m_flowControl)
+            m_flowControl->release(data.size());
+        return;
+    }
+    const auto it = m_pendingSegments.find(segment);
+    if (it != m_pendingSegments.end()) {
+        it->chunks.append({format, data, {}, -1});
+        if (m_flowControl)
+            m_flowControl->buffer(data.size());
+    } else if (m_flowControl) {
+        // cancelled
+        m_flowControl->release(data.size());
+    }
+}
+
+// The processor reports the word's position in the sentence of the segment
+void QTextToSpeechEngineFlite::segmentWord(qsizetype segment, const QString &word,
+                                           qsizetype begin, qsizetype length)
+{
+    const auto it = m_pendingSegments.find(segment);
+    if (it == m_pendingSegments.end())
+        return;
+    begin += it->textOffset;
+    if (segment == m_currentSegment)
+        emit sayingWord(word, begin, length);
+    else
+        it->chunks.append({QAudioFormat(), QByteArray(), word, begin});
+}
+
+void QTextToSpeechEngineFlite::segmentFinished(qsizetype segment)
+{
+    const auto it = m_pendingSegments.find(segment);
+    if (it == m_pendingSegments.end())
+        return;
+    it->finished = true;
+    if (segment == m_currentSegment)
+        deliverSegments();
+}
+
+void QTextToSpeechEngineFlite::deliverSegments()
+{
+    while (true) {
+        const qsizetype segment = m_currentSegment;
+        auto it = m_pendingSegments.find(segment);
+        if (it == m_pendingSegments.end())
+            break;
+        // Receivers might call stop(), so don't hold on to the iterator while emitting
+        auto chunks = std::exchange(it->chunks, {});
+        const bool finished = it->finished;
+        const qsizetype utterance = it->lastOfUtterance;
+        while (!chunks.isEmpty()) {
+            const PendingSegment::Chunk chunk = chunks.takeFirst();
+            if (!chunk.word.isEmpty()) {
+                emit sayingWord(chunk.word, chunk.wordBegin, chunk.word.size());
+            } else {
+                emit synthesized(chunk.format, chunk.data);
+                if (m_flowControl)
+                    m_flowControl->releaseBuffered(chunk.data.size());
+            }
+            if (m_currentSegment != segment) {
+                // cancelled, release the data we still hold
+                for (const auto &chunk : std::as_const(chunks)) {
+                    if (m_flowControl)
+                        m_flowControl->releaseBuffered(chunk.data.size());
+                }
+                return;
+            }
+        }
+        if (!finished)
+            return;
+        m_pendingSegments.remove(segment);
+        setCurrentSegment(segment + 1);
+        if (utterance >= 0) {
+            emit utteranceSynthesized(utterance);
+            if (m_currentSegment != segment + 1)
+                return;
+        }
+    }
+
+    if (m_pendingSegments.isEmpty())
+        changeState(QTextToSpeech::Ready);
+}
+
+void QTextToSpeechEngineFlite::cancelSegments()
+{
+    if (m_pendingSegments.isEmpty())
+        return;
+
+    if (m_flowControl) {
+        for (const PendingSegment &pendingSegment : std::as_const(m_pendingSegments)) {
+            for (const auto &chunk : pendingSegment.chunks)
+                m_flowControl->releaseBuffered(chunk.data.size());
+        }
+    }
+    m_pendingSegments.clear();
+    m_processor->cancelSegments(m_nextSegment);
+    for (const SynthesisWorker &worker : m_synthesisWorkers)
+        worker.processor->cancelSegments(m_nextSegment);
+    // wakes up processors that wait for data to be delivered
+    setCurrentSegment(m_nextSegment);
+}
+
+void QTextToSpeechEngineFlite::setCurrentSegment(qsizetype segment)
+{
+    m_currentSegment = segment;
+    if (m_flowControl)
+        m_flowControl->setDeliveredSegment(segment);
+}
+
 QT_END_NAMESPACE
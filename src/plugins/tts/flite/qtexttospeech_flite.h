@@ -12,6 +12,9 @@
 #include <QtCore/QList>
 #include <QtCore/QLocale>
 #include <QtCore/QMultiHash>
+#include <QtCore/QHash>
+
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
@@ -26,8 +29,11 @@ public:
     // Plug-in API:
     QList<QLocale> availableLocales() const override;
     QList<QVoice> availableVoices() const override;
+    QList<QVoice> allVoices() const override;
     void say(const QString &text) override;
     void synthesize(const QString &text) override;
+    bool synthesizeBatch(const QStringList &texts) override;
+    void prepare(const QStringList &texts) override;
     void stop(QTextToSpeech::BoundaryHint boundaryHint) override;
     void pause(QTextToSpeech::BoundaryHint boundaryHint) override;
     void resume() override;
@@ -52,8 +58,21 @@ Q_SIGNALS:
 private slots:
     void changeState(QTextToSpeech::State newState);
     void setError(QTextToSpeech::ErrorReason error, const QString &errorString);
+    void segmentSynthesized(qsizetype segment, const QAudioFormat &format, const QByteArray &data);
+    void segmentWord(qsizetype segment, const QString &word, qsizetype begin, qsizetype length);
+    void segmentFinished(qsizetype segment);
+    void textPrepared(const QTextToSpeechProcessorFlite::PreparedText &prepared);
 
 private:
+    void startProcessing(const QVariantMap &parameters);
+    void synthesizeSegments(const QString &text, qsizetype utterance);
+    QTextToSpeechProcessorFlite *segmentProcessor(qsizetype segment) const;
+    void deliverSegments();
+    void cancelSegments();
+    void setCurrentSegment(qsizetype segment);
+    bool isPreparedFor(const QTextToSpeechProcessorFlite::PreparedText &prepared,
+                       const QString &text) const;
+
     QTextToSpeech::State m_state = QTextToSpeech::Error;
     QTextToSpeech::ErrorReason m_errorReason = QTextToSpeech::ErrorReason::Initialization;
     QString m_errorString;
@@ -67,8 +86,45 @@ private:
     QMultiHash<QLocale, QVoice> m_voices;
 
     // Thread for blocking operations
-    QThread m_thread;
+    std::unique_ptr<QThread> m_thread;
     std::unique_ptr<QTextToSpeechProcessorFlite> m_processor;
+
+    // Additional threads for parallel synthesis, together with m_processor
+    struct SynthesisWorker
+    {
+        std::unique_ptr<QThread> thread;
+        std::unique_ptr<QTextToSpeechProcessorFlite> processor;
+    };
+    std::vector<SynthesisWorker> m_synthesisWorkers;
+
+    // Segments synthesized in parallel, delivered in order of their number
+    struct PendingSegment
+    {
+        // synthesized data, or a word that starts where the data before it ends
+        struct Chunk
+        {
+            QAudioFormat format;
+            QByteArray data;
+            QString word;
+            qsizetype wordBegin = -1;
+        };
+        QList<Chunk> chunks;
+        bool finished = false;
+        // the position of the segment's sentence in its text
+        qsizetype textOffset = 0;
+        // the text of a batch that ends with this segment, or -1
+        qsizetype lastOfUtterance = -1;
+    };
+    QHash<qsizetype, PendingSegment> m_pendingSegments;
+    qsizetype m_nextSegment = 0;
+    qsizetype m_currentSegment = 0;
+    // Limits the data synthesized ahead of delivery, if set
+    std::unique_ptr<QTextToSpeechFliteFlowControl> m_flowControl;
+
+    // Synthesizes queued texts while the current text is spoken
+    SynthesisWorker m_lookAheadWorker;
+    qsizetype m_lookAhead = 0;
+    QList<QTextToSpeechProcessorFlite::PreparedText> m_preparedTexts;
 };
 
 QT_END_NAMESPACE
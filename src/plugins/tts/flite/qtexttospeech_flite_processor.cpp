@@ -8,13 +8,42 @@
 #include <QtCore/QString>
 #include <QtCore/QLocale>
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSignalBlocker>
+#include <QtCore/QTextBoundaryFinder>
 
 #include <flite/flite.h>
 
+#include <optional>
+
 QT_BEGIN_NAMESPACE
 
 using namespace Qt::StringLiterals;
 
+namespace {
+constexpr QLatin1StringView libPrefix("flite_cmu_%1_%2.so.1");
+constexpr QLatin1StringView registerPrefix("register_cmu_%1_%2");
+constexpr QLatin1StringView unregisterPrefix("unregister_cmu_%1_%2");
+
+// Finding the voice libraries requires scanning the library paths, so it is
+// only done once per process.
+struct DiscoveredVoices
+{
+    QMutex mutex;
+    std::optional<QList<QTextToSpeechProcessorFlite::VoiceInfo>> voices;
+};
+Q_GLOBAL_STATIC(DiscoveredVoices, discoveredVoices)
+Q_GLOBAL_STATIC(QTextToSpeechFliteVoiceRegistry, voiceRegistry)
+
+// Amount of audio that the sink can pull ahead of the synthesis, in microseconds
+constexpr qint64 AudioBufferDuration = 500000;
+// Interval for moving data kept aside into the buffer, in milliseconds
+constexpr int AudioBufferFlushInterval = 10;
+// say() synthesizes longer texts in parts of at most that many characters, so that
+// the data that the audio buffer keeps aside stays bounded
+constexpr qsizetype MaxUtteranceLength = 500;
+}
+
 QTextToSpeechProcessorFlite::QTextToSpeechProcessorFlite(const QAudioDevice &audioDevice)
     : m_audioDevice(audioDevice)
 {
@@ -23,8 +52,13 @@ QTextToSpeechProcessorFlite::QTextToSpeechProcessorFlite(const QAudioDevice &aud
 
 QTextToSpeechProcessorFlite::~QTextToSpeechProcessorFlite()
 {
-    for (const VoiceInfo &voice : std::as_const(m_voices))
-        voice.unregister_func(voice.vox);
+    // the sink must not read from the buffer once it is gone; usually the sink
+    // has already been deleted when the processor's thread finished
+    deleteSink();
+    if (voiceRegistry.isDestroyed())
+        return;
+    for (const auto &[id, voice] : m_acquiredVoices)
+        voiceRegistry->release(id);
 }
 
 const QList<QTextToSpeechProcessorFlite::VoiceInfo> &QTextToSpeechProcessorFlite::voices() const
@@ -36,9 +70,26 @@ void QTextToSpeechProcessorFlite::startTokenTimer()
 {
     qCDebug(lcSpeechTtsFlite) << "Starting token timer with" << m_tokens.count() - m_currentToken << "left";
 
+    // started again once the sink becomes active
+    if (!m_audioSink || !m_audioBuffer)
+        return;
+
     const TokenData &token = m_tokens.at(m_currentToken);
-    const qint64 playedTime = m_audioSink->processedUSecs() / 1000;
-    m_tokenTimer.start(qMax(token.startTime - playedTime, 0), Qt::PreciseTimer, this);
+    // The sink might have played previous utterances, and the token times refer
+    // to the data before it got stretched
+    const qint64 playedBytes = m_audioBuffer->appendedBytes(
+            m_format.bytesForDuration(m_audioSink->processedUSecs())) - m_playedBytes;
+    const qint64 playedTime = m_format.durationForBytes(qMax(playedBytes, 0)) / 1000;
+    const double speed = m_audioBuffer->speed();
+    m_tokenTimer.start(qMax(qRound64((token.startTime - playedTime) / speed), 0),
+                       Qt::PreciseTimer, this);
+}
+
+// The speed of playback changed
+void QTextToSpeechProcessorFlite::retimeTokens()
+{
+    if (m_tokenTimer.isActive())
+        startTokenTimer();
 }
 
 int QTextToSpeechProcessorFlite::audioOutputCb(const cst_wave *w, int start, int size,
@@ -46,63 +97,94 @@ int QTextToSpeechProcessorFlite::audioOutputCb(const cst_wave *w, int start, int
 {
     QTextToSpeechProcessorFlite *processor = static_cast<QTextToSpeechProcessorFlite *>(asi->userdata);
     if (processor) {
-        if (asi->item == NULL)
-            asi->item = relation_head(utt_relation(asi->utt,"Token"));
-
-        const float startTime = flite_ffeature_float(asi->item, "R:Token.daughter1.R:SylStructure.daughter1.daughter1.R:Segment.p.end");
-        const int startSample = int(startTime * float(w->sample_rate));
-        if ((startSample >= start) && (startSample < start + size)) {
-            const char *ws = flite_ffeature_string(asi->item, "whitespace");
-            const char *prepunc = flite_ffeature_string(asi->item, "prepunctuation");
-            if (cst_streq("0",prepunc))
-                prepunc = "";
-            const char *token = flite_ffeature_string(asi->item, "name");
-            const char *postpunc = flite_ffeature_string(asi->item, "punc");
-            if (cst_streq("0",postpunc))
-                postpunc = "";
-            if (token) {
-                qCDebug(lcSpeechTtsFlite).nospace() << "Processing token start_time: " << startTime
-                                                    << " content: \"" << ws << prepunc << "'" << token << "'" << postpunc << "\"";
-                processor->m_tokens.append(TokenData{
-                    qRound(startTime * 1000),
-                    QString::fromUtf8(token)
-                });
-                if (!processor->m_tokenTimer.isActive())
-                    processor->startTokenTimer();
-            }
-            asi->item = item_next(asi->item);
+        if (start == 0)
+            processor->m_droppedBytes = 0;
+        while (readToken(w, start, size, asi, processor->m_tokens)) {
+            processor->m_tokens.last().startTime += processor->m_sentenceStartTime
+                                                  - processor->droppedTime(w);
+            if (!processor->m_tokenTimer.isActive())
+                processor->startTokenTimer();
         }
         return processor->audioOutput(w, start, size, last, asi);
     }
     return CST_AUDIO_STREAM_STOP;
 }
 
+// Append the next token to tokens if it starts before the end of this chunk
+bool QTextToSpeechProcessorFlite::readToken(const cst_wave *w, int start, int size,
+                                            cst_audio_streaming_info *asi,
+                                            QList<TokenData> &tokens)
+{
+    // each utterance streams its own wave; once all tokens are read, the item stays null
+    if (start == 0)
+        asi->item = relation_head(utt_relation(asi->utt,"Token"));
+    if (asi->item == NULL)
+        return false;
+
+    const float startTime = flite_ffeature_float(asi->item, "R:Token.daughter1.R:SylStructure.daughter1.daughter1.R:Segment.p.end");
+    const int startSample = int(startTime * float(w->sample_rate));
+    // a token that started in an earlier chunk is reported late rather than never
+    if (startSample >= start + size)
+        return false;
+
+    const char *ws = flite_ffeature_string(asi->item, "whitespace");
+    const char *prepunc = flite_ffeature_string(asi->item, "prepunctuation");
+    if (cst_streq("0",prepunc))
+        prepunc = "";
+    const char *token = flite_ffeature_string(asi->item, "name");
+    const char *postpunc = flite_ffeature_string(asi->item, "punc");
+    if (cst_streq("0",postpunc))
+        postpunc = "";
+    if (token) {
+        qCDebug(lcSpeechTtsFlite).nospace() << "Processing token start_time: " << startTime
+                                            << " content: \"" << ws << prepunc << "'" << token << "'" << postpunc << "\"";
+        tokens.append(TokenData{
+            qRound(startTime * 1000),
+            QString::fromUtf8(token)
+        });
+    }
+    asi->item = item_next(asi->item);
+    return token != nullptr;
+}
+
 int QTextToSpeechProcessorFlite::audioOutput(const cst_wave *w, int start, int size,
                                              int last, cst_audio_streaming_info *asi)
 {
-    Q_UNUSED(asi);
     Q_ASSERT(QThread::currentThread() == thread());
     if (size == 0)
         return CST_AUDIO_STREAM_CONT;
-    if (start == 0 && !initAudio(w->sample_rate, w->num_channels))
+    // When streaming sentences, they all get played by the same sink
+    const bool firstChunk = start == 0 && m_nextSentence <= 1;
+    if (firstChunk && !initAudio(w->sample_rate, w->num_channels))
         return CST_AUDIO_STREAM_STOP;
 
-    const qsizetype bytesToWrite = size * sizeof(short);
-
-    if (!m_audioBuffer->write(reinterpret_cast<const char *>(&w->samples[start]), bytesToWrite)) {
-        setError(QTextToSpeech::ErrorReason::Playback,
-                 QCoreApplication::translate("QTextToSpeech", "Audio streaming error."));
-        stop();
+    if (!m_audioBuffer)
         return CST_AUDIO_STREAM_STOP;
+    // The buffer stretches the data if the rate changes during playback
+    if (firstChunk) {
+        m_audioBuffer->setUtteranceStretch(get_param_float(asi->utt->features,
+                                                           "duration_stretch", 1.0));
+    }
+
+    const bool lastChunk = last == 1 && m_nextSentence >= m_sentences.size();
+    QByteArrayView data = processChunk(w, start, size, firstChunk, lastChunk);
+    if (m_audioConverter) {
+        m_audioConverter->convert(data, m_convertedData, lastChunk);
+        data = m_convertedData;
     }
 
+    // Keeps what doesn't fit until the sink makes room
+    const qsizetype bytesToWrite = data.size();
+    m_audioBuffer->append(data.data(), bytesToWrite);
+
     // Stats for debugging
     ++numberChunks;
     totalBytes += bytesToWrite;
+    emit audioWritten(m_format, bytesToWrite);
 
-    if (last == 1) {
+    if (lastChunk) {
         qCDebug(lcSpeechTtsFlite) << "last data chunk written";
-        m_audioBuffer->close();
+        m_audioBuffer->finish();
     }
     return CST_AUDIO_STREAM_CONT;
 }
@@ -117,24 +199,77 @@ int QTextToSpeechProcessorFlite::dataOutputCb(const cst_wave *w, int start, int
 }
 
 int QTextToSpeechProcessorFlite::dataOutput(const cst_wave *w, int start, int size,
-                                            int last, cst_audio_streaming_info *)
+                                            int last, cst_audio_streaming_info *asi)
 {
-    if (start == 0)
+    if (m_segment >= 0) {
+        // the engine is no longer interested in this segment
+        if (m_segment < m_firstValidSegment.load(std::memory_order_relaxed))
+            return CST_AUDIO_STREAM_STOP;
+    } else if (start == 0) {
         emit stateChanged(QTextToSpeech::Synthesizing);
+    }
 
-    QAudioFormat format;
-    if (w->num_channels == 1)
-        format.setChannelConfig(QAudioFormat::ChannelConfigMono);
-    else
-        format.setChannelCount(w->num_channels);
-    format.setSampleRate(w->sample_rate);
-    format.setSampleFormat(QAudioFormat::Int16);
+    if (m_dataFormat.sampleRate() != w->sample_rate
+        || m_dataFormat.channelCount() != w->num_channels) {
+        m_dataFormat = QAudioFormat();
+        if (w->num_channels == 1)
+            m_dataFormat.setChannelConfig(QAudioFormat::ChannelConfigMono);
+        else
+            m_dataFormat.setChannelCount(w->num_channels);
+        m_dataFormat.setSampleRate(w->sample_rate);
+        m_dataFormat.setSampleFormat(QAudioFormat::Int16);
+    }
 
-    if (!format.isValid())
+    if (!m_dataFormat.isValid())
         return CST_AUDIO_STREAM_STOP;
 
-    const qsizetype bytesToWrite = size * format.bytesPerSample();
-    emit synthesized(format, QByteArray(reinterpret_cast<const char *>(&w->samples[start]), bytesToWrite));
+    // The words that start in this chunk are reported before its data, so that
+    // receivers know where in the data each word starts.
+    while (readToken(w, start, size, asi, m_tokens))
+        reportWord(m_tokens.constLast().text);
+
+    QByteArrayView samples = processChunk(w, start, size, start == 0, last == 1);
+
+    // Deliver the data in the format requested by the application
+    QAudioFormat format = m_dataFormat;
+    QByteArray &buffer = pooledBuffer();
+    if (m_synthesisFormat.isValid() && m_synthesisFormat != m_dataFormat) {
+        if (!m_dataConverter || m_dataConverter->inputFormat() != m_dataFormat) {
+            m_dataConverter = std::make_unique<QTextToSpeechAudioConverter>(m_dataFormat,
+                                                                            m_synthesisFormat);
+        } else if (start == 0) {
+            m_dataConverter->reset();
+        }
+        if (!m_dataConverter->isValid()) {
+            QString formatString;
+            QDebug(&formatString) << m_synthesisFormat;
+            setError(QTextToSpeech::ErrorReason::Configuration,
+                     QCoreApplication::translate("QTextToSpeech", "Invalid audio format: %1")
+                        .arg(formatString));
+            return CST_AUDIO_STREAM_STOP;
+        }
+        // convert straight into the buffer that gets emitted
+        m_dataConverter->convert(samples, buffer, last == 1);
+        format = m_synthesisFormat;
+    } else {
+        // the samples belong to flite's wave, which is deleted with the utterance
+        buffer.assign(samples);
+    }
+
+    const qsizetype bytesToWrite = buffer.size();
+    if (m_segment >= 0) {
+        // the resampler might hold back all of a short chunk
+        if (!bytesToWrite)
+            return CST_AUDIO_STREAM_CONT;
+        // wait until the engine has delivered enough of the data emitted before
+        if (m_flowControl && !m_flowControl->acquire(bytesToWrite, m_segment, m_firstValidSegment))
+            return CST_AUDIO_STREAM_STOP;
+        emit segmentSynthesized(m_segment, format, buffer);
+        return CST_AUDIO_STREAM_CONT;
+    }
+
+    if (bytesToWrite)
+        emit synthesized(format, buffer);
 
     if (last == 1)
         emit stateChanged(QTextToSpeech::Ready);
@@ -142,18 +277,109 @@ int QTextToSpeechProcessorFlite::dataOutput(const cst_wave *w, int start, int si
     return CST_AUDIO_STREAM_CONT;
 }
 
+int QTextToSpeechProcessorFlite::preparedOutputCb(const cst_wave *w, int start, int size,
+                                                  int last, cst_audio_streaming_info *asi)
+{
+    QTextToSpeechProcessorFlite *processor = static_cast<QTextToSpeechProcessorFlite *>(asi->userdata);
+    if (processor)
+        return processor->preparedOutput(w, start, size, last, asi);
+    return CST_AUDIO_STREAM_STOP;
+}
+
+int QTextToSpeechProcessorFlite::preparedOutput(const cst_wave *w, int start, int size,
+                                                int last, cst_audio_streaming_info *asi)
+{
+    if (!m_preparing)
+        return CST_AUDIO_STREAM_STOP;
+
+    PreparedText &prepared = *m_preparing;
+    if (start == 0) {
+        // flite synthesizes each sentence as a separate utterance
+        if (prepared.sampleRate == 0) {
+            prepared.sampleRate = w->sample_rate;
+            prepared.channelCount = w->num_channels;
+        } else if (prepared.sampleRate != w->sample_rate
+                   || prepared.channelCount != w->num_channels) {
+            return CST_AUDIO_STREAM_STOP;
+        }
+        const qint64 frames = prepared.data.size() / qsizetype(sizeof(short) * w->num_channels);
+        m_preparingOffset = frames * 1000 / w->sample_rate;
+        m_droppedBytes = 0;
+    }
+    while (readToken(w, start, size, asi, prepared.tokens))
+        prepared.tokens.last().startTime += m_preparingOffset - droppedTime(w);
+    prepared.data.append(processChunk(w, start, size, start == 0, last == 1));
+    return CST_AUDIO_STREAM_CONT;
+}
+
+// Run the processing chain on flite's samples in place, and return the data that
+// remains. The wave belongs to the utterance that we synthesize, and flite doesn't
+// read the samples again once they have been streamed.
+QByteArrayView QTextToSpeechProcessorFlite::processChunk(const cst_wave *w, int start, int size,
+                                                         bool first, bool last)
+{
+    char *data = reinterpret_cast<char *>(const_cast<short *>(&w->samples[start]));
+    const qsizetype bytes = size * qsizetype(sizeof(short));
+    if (m_processingChain.isEmpty())
+        return QByteArrayView(data, bytes);
+
+    QTextToSpeechProcessingChain::Chunk chunk;
+    chunk.format.setSampleFormat(QAudioFormat::Int16);
+    chunk.format.setSampleRate(w->sample_rate);
+    chunk.format.setChannelCount(w->num_channels);
+    chunk.data = data;
+    chunk.size = bytes;
+    chunk.first = first;
+    chunk.last = last;
+    m_processingChain.process(chunk);
+    m_droppedBytes += bytes - chunk.size;
+    return QByteArrayView(chunk.data, chunk.size);
+}
+
+// The duration of the data that the processing chain dropped from the current
+// utterance, in milliseconds
+qint64 QTextToSpeechProcessorFlite::droppedTime(const cst_wave *w) const
+{
+    return m_droppedBytes / qint64(sizeof(short) * w->num_channels) * 1000 / w->sample_rate;
+}
+
+// Return a buffer that is no longer referenced by any receiver of previously
+// emitted chunks, so that we don't have to allocate memory for each chunk when
+// synthesizing long texts. The data gets written into the buffer, which is then
+// emitted as it is.
+QByteArray &QTextToSpeechProcessorFlite::pooledBuffer()
+{
+    auto it = std::find_if(m_bufferPool.begin(), m_bufferPool.end(), [](const QByteArray &buffer){
+        return buffer.isDetached();
+    });
+    if (it != m_bufferPool.end())
+        return *it;
+    if (m_bufferPool.size() < MaxPooledBuffers)
+        return m_bufferPool.emplace_back();
+    // all buffers are still in use by slow receivers
+    m_unpooledBuffer = QByteArray();
+    return m_unpooledBuffer;
+}
+
 void QTextToSpeechProcessorFlite::timerEvent(QTimerEvent *event)
 {
+    if (event->timerId() == m_voiceIdleTimer.timerId()) {
+        releaseIdleVoices();
+        return;
+    }
+    if (event->timerId() == m_audioIdleTimer.timerId()) {
+        qCDebug(lcSpeechTtsFlite) << "Closing idle audio sink";
+        m_audioIdleTimer.stop();
+        deleteSink();
+        return;
+    }
     if (event->timerId() != m_tokenTimer.timerId()) {
         QObject::timerEvent(event);
         return;
     }
 
     qCDebug(lcSpeechTtsFlite) << "Moving current token" << m_currentToken << m_tokens.size();
-    auto currentToken = m_tokens.at(m_currentToken);
-    m_index = m_text.indexOf(currentToken.text, m_index);
-    emit sayingWord(currentToken.text, m_index, currentToken.text.length());
-    m_index += currentToken.text.length();
+    reportWord(m_tokens.at(m_currentToken).text);
     ++m_currentToken;
     if (m_currentToken == m_tokens.size())
         m_tokenTimer.stop();
@@ -161,6 +387,17 @@ void QTextToSpeechProcessorFlite::timerEvent(QTimerEvent *event)
         startTokenTimer();
 }
 
+// Emits the word with its position in the text; words are reported in order
+void QTextToSpeechProcessorFlite::reportWord(const QString &word)
+{
+    m_index = m_text.indexOf(word, m_index);
+    if (m_segment >= 0)
+        emit segmentWord(m_segment, word, m_index, word.length());
+    else
+        emit sayingWord(word, m_index, word.length());
+    m_index += word.length();
+}
+
 void QTextToSpeechProcessorFlite::processText(const QString &text, int voiceId, double pitch, double rate, OutputHandler outputHandler)
 {
     qCDebug(lcSpeechTtsFlite) << "processText() begin";
@@ -171,16 +408,7 @@ void QTextToSpeechProcessorFlite::processText(const QString &text, int voiceId,
     m_tokens.clear();
     m_currentToken = 0;
     m_index = 0;
-    float secsToSpeak = -1;
-    const VoiceInfo &voiceInfo = m_voices.at(voiceId);
-    cst_voice *voice = voiceInfo.vox;
-    cst_audio_streaming_info *asi = new_audio_streaming_info();
-    asi->asc = outputHandler;
-    asi->userdata = (void *)this;
-    feat_set(voice->features, "streaming_info", audio_streaming_info_val(asi));
-    setRateForVoice(voice, rate);
-    setPitchForVoice(voice, pitch);
-    secsToSpeak = flite_text_to_speech(text.toUtf8().constData(), voice, "none");
+    const float secsToSpeak = synthesizeText(text, voiceId, pitch, rate, outputHandler);
 
     if (secsToSpeak <= 0) {
         setError(QTextToSpeech::ErrorReason::Input,
@@ -191,7 +419,39 @@ void QTextToSpeechProcessorFlite::processText(const QString &text, int voiceId,
     qCDebug(lcSpeechTtsFlite) << "processText() end" << secsToSpeak << "Seconds";
 }
 
-void QTextToSpeechProcessorFlite::setRateForVoice(cst_voice *voice, float rate)
+// Run flite on text, passing the output to outputHandler
+float QTextToSpeechProcessorFlite::synthesizeText(const QString &text, int voiceId, double pitch,
+                                                  double rate, OutputHandler outputHandler)
+{
+    cst_voice *voice = acquiredVoice(voiceId);
+    if (!voice)
+        return 0;
+
+    // Same as flite_text_to_speech(), but the features are set on the utterance,
+    // as the voice may be used by other processors at the same time.
+    cst_utterance *utterance = new_utterance();
+    utt_set_input_text(utterance, text.toUtf8().constData());
+    cst_audio_streaming_info *asi = new_audio_streaming_info();
+    asi->asc = outputHandler;
+    asi->userdata = (void *)this;
+    feat_set(utterance->features, "streaming_info", audio_streaming_info_val(asi));
+    setRateForUtterance(utterance, rate);
+    setPitchForUtterance(utterance, pitch);
+
+    // links the features of the voice into those of the utterance, and
+    // deletes the utterance if synthesis fails
+    utterance = flite_do_synth(utterance, voice, utt_synth);
+    if (!utterance)
+        return 0;
+
+    float duration = 0;
+    if (const cst_wave *wave = utt_wave(utterance); wave && wave->sample_rate > 0)
+        duration = float(wave->num_samples) / float(wave->sample_rate);
+    delete_utterance(utterance);
+    return duration;
+}
+
+float QTextToSpeechProcessorFlite::durationStretch(double rate)
 {
     float stretch = 1.0;
     Q_ASSERT(rate >= -1.0 && rate <= 1.0);
@@ -200,16 +460,29 @@ void QTextToSpeechProcessorFlite::setRateForVoice(cst_voice *voice, float rate)
         stretch -= rate * 2;
     if (rate > 0)
         stretch -= rate * (100.0 / 175.0);
-    feat_set_float(voice->features, "duration_stretch", stretch);
+    return stretch;
+}
+
+void QTextToSpeechProcessorFlite::setRateForUtterance(cst_utterance *utterance, float rate)
+{
+    feat_set_float(utterance->features, "duration_stretch", durationStretch(rate));
 }
 
-void QTextToSpeechProcessorFlite::setPitchForVoice(cst_voice *voice, float pitch)
+void QTextToSpeechProcessorFlite::setPlaybackRate(double rate)
+{
+    m_playbackStretch.store(durationStretch(rate));
+    // the token timer runs on the processor's thread
+    QMetaObject::invokeMethod(this, &QTextToSpeechProcessorFlite::retimeTokens,
+                              Qt::QueuedConnection);
+}
+
+void QTextToSpeechProcessorFlite::setPitchForUtterance(cst_utterance *utterance, float pitch)
 {
     float f0;
     Q_ASSERT(pitch >= -1.0 && pitch <= 1.0);
     // Conversion taken from Speech Dispatcher
     f0 = (pitch * 80) + 100;
-    feat_set_float(voice->features, "int_f0_target_mean", f0);
+    feat_set_float(utterance->features, "int_f0_target_mean", f0);
 }
 
 typedef cst_voice*(*registerFnType)();
@@ -218,47 +491,149 @@ typedef void(*unregisterFnType)(cst_voice *);
 bool QTextToSpeechProcessorFlite::init()
 {
     flite_init();
+    m_voices = discoverVoices();
+    return !m_voices.isEmpty();
+}
 
+QList<QTextToSpeechProcessorFlite::VoiceInfo> QTextToSpeechProcessorFlite::discoverVoices()
+{
+    QMutexLocker locker(&discoveredVoices->mutex);
+    if (discoveredVoices->voices)
+        return *discoveredVoices->voices;
+
+    flite_init();
     const QLocale locale(QLocale::English, QLocale::UnitedStates);
     // ### FIXME: hardcode for now, the only voice files we know about are for en_US
     // We could source the language and perhaps the list of voices we want to load
     // (hardcoded below) from an environment variable.
     const QLatin1StringView langCode("us");
-    const QLatin1StringView libPrefix("flite_cmu_%1_%2.so.1");
-    const QLatin1StringView registerPrefix("register_cmu_%1_%2");
-    const QLatin1StringView unregisterPrefix("unregister_cmu_%1_%2");
 
+    QList<VoiceInfo> voices;
     for (const auto &voice : fliteAvailableVoices(libPrefix, langCode)) {
-        QLibrary library(libPrefix.arg(langCode, voice));
-        if (!library.load()) {
-            qWarning("Voice library could not be loaded: %s", qPrintable(library.fileName()));
-            continue;
-        }
-        auto registerFn = reinterpret_cast<registerFnType>(library.resolve(
-            registerPrefix.arg(langCode, voice).toLatin1().constData()));
-        auto unregisterFn = reinterpret_cast<unregisterFnType>(library.resolve(
-            unregisterPrefix.arg(langCode, voice).toLatin1().constData()));
-        if (registerFn && unregisterFn) {
-            const int id = m_voices.count();
-            m_voices.append(VoiceInfo{
-                id,
-                registerFn(),
-                unregisterFn,
-                voice,
-                locale.name(),
-                QVoice::Male,
-                QVoice::Adult
-            });
+        const int id = voices.count();
+        voices.append(VoiceInfo{
+            id,
+            voice,
+            locale.name(),
+            QVoice::Male,
+            QVoice::Adult,
+            langCode
+        });
+    }
+    discoveredVoices->voices = voices;
+    return voices;
+}
+
+// Returns the voice, and acquires it from the registry if it's used for the first time
+cst_voice *QTextToSpeechProcessorFlite::acquiredVoice(int voiceId)
+{
+    auto it = m_acquiredVoices.find(voiceId);
+    if (it == m_acquiredVoices.end()) {
+        const VoiceInfo &voiceInfo = m_voices.at(voiceId);
+        cst_voice *vox = voiceRegistry->acquire(voiceId, voiceInfo.name, voiceInfo.langCode);
+        if (!vox)
+            return nullptr;
+        it = m_acquiredVoices.emplace(voiceId, AcquiredVoice{vox}).first;
+    }
+
+    it->second.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    if (m_voiceIdleTimeout > 0 && !m_voiceIdleTimer.isActive())
+        m_voiceIdleTimer.start(m_voiceIdleTimeout, this);
+    return it->second.vox;
+}
+
+void QTextToSpeechProcessorFlite::releaseIdleVoices()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = m_acquiredVoices.begin(); it != m_acquiredVoices.end();) {
+        if (now - it->second.lastUsed >= m_voiceIdleTimeout) {
+            qCDebug(lcSpeechTtsFlite) << "Releasing idle voice" << m_voices.at(it->first).name;
+            voiceRegistry->release(it->first);
+            it = m_acquiredVoices.erase(it);
         } else {
-            library.unload();
+            ++it;
         }
     }
+    if (m_acquiredVoices.empty())
+        m_voiceIdleTimer.stop();
+}
 
-    return !m_voices.isEmpty();
+cst_voice *QTextToSpeechFliteVoiceRegistry::acquire(int id, const QString &name,
+                                                    const QString &langCode)
+{
+    {
+        QReadLocker locker(&m_lock);
+        if (const auto it = m_voices.find(id); it != m_voices.end()) {
+            it->second.refCount.fetch_add(1, std::memory_order_relaxed);
+            return it->second.vox;
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    auto [it, inserted] = m_voices.try_emplace(id);
+    if (inserted && !registerVoice(name, langCode, it->second)) {
+        m_voices.erase(it);
+        return nullptr;
+    }
+    it->second.refCount.fetch_add(1, std::memory_order_relaxed);
+    return it->second.vox;
+}
+
+void QTextToSpeechFliteVoiceRegistry::release(int id)
+{
+    QWriteLocker locker(&m_lock);
+    const auto it = m_voices.find(id);
+    if (it == m_voices.end())
+        return;
+    if (it->second.refCount.fetch_sub(1, std::memory_order_relaxed) == 1) {
+        qCDebug(lcSpeechTtsFlite) << "Unregistering voice" << id;
+        unregisterVoice(it->second);
+        m_voices.erase(it);
+    }
+}
+
+bool QTextToSpeechFliteVoiceRegistry::registerVoice(const QString &name, const QString &langCode,
+                                                    Voice &voice)
+{
+    // Statically linked voices are registered already
+    for (const cst_val *v = flite_voice_list; v; v = val_cdr(v)) {
+        cst_voice *staticVoice = val_voice(val_car(v));
+        if (name == QLatin1StringView(staticVoice->name)) {
+            voice.vox = staticVoice;
+            return true;
+        }
+    }
+
+    voice.library = std::make_unique<QLibrary>(libPrefix.arg(langCode, name));
+    if (!voice.library->load()) {
+        qWarning("Voice library could not be loaded: %s", qPrintable(voice.library->fileName()));
+        return false;
+    }
+    auto registerFn = reinterpret_cast<registerFnType>(voice.library->resolve(
+        registerPrefix.arg(langCode, name).toLatin1().constData()));
+    auto unregisterFn = reinterpret_cast<unregisterFnType>(voice.library->resolve(
+        unregisterPrefix.arg(langCode, name).toLatin1().constData()));
+    if (!registerFn || !unregisterFn) {
+        voice.library->unload();
+        return false;
+    }
+
+    qCDebug(lcSpeechTtsFlite) << "Registering voice" << name;
+    voice.vox = registerFn();
+    voice.unregister_func = unregisterFn;
+    return voice.vox != nullptr;
+}
+
+void QTextToSpeechFliteVoiceRegistry::unregisterVoice(Voice &voice)
+{
+    if (voice.unregister_func)
+        voice.unregister_func(voice.vox);
+    if (voice.library)
+        voice.library->unload();
 }
 
 QStringList QTextToSpeechProcessorFlite::fliteAvailableVoices(const QString &libPrefix,
-                                                              const QString &langCode) const
+                                                              const QString &langCode)
 {
     // Read statically linked voices
     QStringList voices;
@@ -298,39 +673,61 @@ QStringList QTextToSpeechProcessorFlite::fliteAvailableVoices(const QString &lib
 
 bool QTextToSpeechProcessorFlite::initAudio(double rate, int channelCount)
 {
-    m_format.setSampleFormat(QAudioFormat::Int16);
-    m_format.setSampleRate(rate);
-    m_format.setChannelCount(channelCount);
+    QAudioFormat format;
+    format.setSampleFormat(QAudioFormat::Int16);
+    format.setSampleRate(rate);
+    format.setChannelCount(channelCount);
     switch (channelCount) {
     case 1:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigMono);
+        format.setChannelConfig(QAudioFormat::ChannelConfigMono);
         break;
     case 2:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigStereo);
+        format.setChannelConfig(QAudioFormat::ChannelConfigStereo);
         break;
     case 3:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfig2Dot1);
+        format.setChannelConfig(QAudioFormat::ChannelConfig2Dot1);
         break;
     case 5:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigSurround5Dot0);
+        format.setChannelConfig(QAudioFormat::ChannelConfigSurround5Dot0);
         break;
     case 6:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigSurround5Dot1);
+        format.setChannelConfig(QAudioFormat::ChannelConfigSurround5Dot1);
         break;
     case 7:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigSurround7Dot0);
+        format.setChannelConfig(QAudioFormat::ChannelConfigSurround7Dot0);
         break;
     case 8:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigSurround7Dot1);
+        format.setChannelConfig(QAudioFormat::ChannelConfigSurround7Dot1);
         break;
     default:
-        m_format.setChannelConfig(QAudioFormat::ChannelConfigUnknown);
+        format.setChannelConfig(QAudioFormat::ChannelConfigUnknown);
         break;
     }
+    // Play through a converter if the device doesn't support flite's format
+    QAudioFormat sinkFormat = format;
+    if (!m_audioDevice.isNull() && !m_audioDevice.isFormatSupported(format))
+        sinkFormat = m_audioDevice.preferredFormat();
+    if (sinkFormat != format) {
+        if (!m_audioConverter || m_audioConverter->inputFormat() != format
+            || m_audioConverter->outputFormat() != sinkFormat) {
+            qCDebug(lcSpeechTtsFlite) << "Converting" << format << "to" << sinkFormat;
+            m_audioConverter = std::make_unique<QTextToSpeechAudioConverter>(format, sinkFormat);
+        } else {
+            m_audioConverter->reset();
+        }
+        // checkFormat() reports the unsupported format
+        if (!m_audioConverter->isValid())
+            sinkFormat = format;
+    }
+    if (sinkFormat == format)
+        m_audioConverter.reset();
+    m_format = sinkFormat;
     if (!checkFormat(m_format))
        return false;
 
     createSink();
+    if (!m_audioSink)
+        return false;
 
     m_audioSink->setVolume(m_volume);
 
@@ -343,12 +740,13 @@ void QTextToSpeechProcessorFlite::deleteSink()
         m_audioSink->disconnect();
         delete m_audioSink;
         m_audioSink = nullptr;
-        m_audioBuffer = nullptr;
     }
+    m_audioBuffer.reset();
 }
 
 void QTextToSpeechProcessorFlite::createSink()
 {
+    m_audioIdleTimer.stop();
     // Create new sink if none exists or the format has changed
     if (!m_audioSink || (m_audioSink->format() != m_format)) {
         // No signals while we create new sink with QIODevice
@@ -359,9 +757,31 @@ void QTextToSpeechProcessorFlite::createSink()
         m_audioSink = new QAudioSink(m_audioDevice, m_format, this);
         connect(m_audioSink, &QAudioSink::stateChanged, this, &QTextToSpeechProcessorFlite::changeState);
         connect(QThread::currentThread(), &QThread::finished, m_audioSink, &QObject::deleteLater);
+    } else if (m_audioBuffer && m_audioBuffer->isDrained()
+               && m_audioSink->state() == QAudio::IdleState) {
+        // The sink has played the previous utterance; keep it open and feed it
+        // the next one, without reopening and priming the device.
+        qCDebug(lcSpeechTtsFlite) << "Reusing audio sink";
+        m_playedBytes += totalBytes;
+        m_audioBuffer->restart();
+        numberChunks = 0;
+        totalBytes = 0;
+        return;
     }
-    m_audioBuffer = m_audioSink->start();
-    if (!m_audioBuffer) {
+
+    // The sink pulls the data that flite appends to the buffer. Replacing the
+    // buffer of a running sink restarts it.
+    auto audioBuffer = std::make_unique<QTextToSpeechFliteAudioBuffer>(
+            m_format.bytesForDuration(AudioBufferDuration), m_format, m_playbackStretch);
+    audioBuffer->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    connect(audioBuffer.get(), &QTextToSpeechFliteAudioBuffer::finished,
+            this, &QTextToSpeechProcessorFlite::audioBufferFinished);
+    connect(audioBuffer.get(), &QTextToSpeechFliteAudioBuffer::flushed,
+            this, &QTextToSpeechProcessorFlite::scheduleNextSentence);
+    m_audioSink->start(audioBuffer.get());
+    m_audioBuffer = std::move(audioBuffer);
+    m_playedBytes = 0;
+    if (m_audioSink->error() == QAudio::OpenError) {
         deleteSink();
         setError(QTextToSpeech::ErrorReason::Playback,
                  QCoreApplication::translate("QTextToSpeech", "Audio Open error: No I/O device available."));
@@ -377,6 +797,18 @@ void QTextToSpeechProcessorFlite::changeState(QAudio::State newState)
     if (m_state == newState)
         return;
 
+    // The sink ran out of data before the next sentence got synthesized
+    if (newState == QAudio::IdleState && m_nextSentence < m_sentences.size()) {
+        qCDebug(lcSpeechTtsFlite) << "Audio sink underrun while streaming sentences";
+        return;
+    }
+
+    // The sink ran out of data before flite synthesized the rest of the text
+    if (newState == QAudio::IdleState && m_audioBuffer && !m_audioBuffer->isDrained()) {
+        qCDebug(lcSpeechTtsFlite) << "Audio sink underrun";
+        return;
+    }
+
     qCDebug(lcSpeechTtsFlite) << "Audio sink state transition" << m_state << newState;
 
     switch (newState) {
@@ -386,9 +818,13 @@ void QTextToSpeechProcessorFlite::changeState(QAudio::State newState)
             startTokenTimer();
         break;
     case QAudio::SuspendedState:
+        m_tokenTimer.stop();
+        break;
     case QAudio::IdleState:
     case QAudio::StoppedState:
         m_tokenTimer.stop();
+        if (m_audioIdleTimeout > 0 && m_audioSink)
+            m_audioIdleTimer.start(m_audioIdleTimeout, this);
         break;
     }
 
@@ -397,6 +833,14 @@ void QTextToSpeechProcessorFlite::changeState(QAudio::State newState)
     emit stateChanged(ttsState);
 }
 
+// The sink might have run out of data, and gone idle, before the last chunk
+// got appended to the buffer.
+void QTextToSpeechProcessorFlite::audioBufferFinished()
+{
+    if (m_audioSink && m_audioSink->state() == QAudio::IdleState && m_audioBuffer->isDrained())
+        changeState(QAudio::IdleState);
+}
+
 void QTextToSpeechProcessorFlite::setError(QTextToSpeech::ErrorReason err, const QString &errorString)
 {
      if (err == QTextToSpeech::ErrorReason::NoError) {
@@ -429,7 +873,12 @@ void QTextToSpeechProcessorFlite::deinitAudio()
     m_tokenTimer.stop();
     m_index = -1;
     m_currentToken = -1;
-    deleteSink();
+    // Keep the sink, so that the next utterance doesn't have to create it again
+    if (m_audioSink) {
+        const QSignalBlocker blocker(m_audioSink);
+        m_audioSink->stop();
+    }
+    m_audioBuffer.reset();
 }
 
 // Check format/device and set corresponding error messages
@@ -468,11 +917,17 @@ bool QTextToSpeechProcessorFlite::checkFormat(const QAudioFormat &format)
 // Check voice validity
 bool QTextToSpeechProcessorFlite::checkVoice(int voiceId)
 {
-    if (voiceId >= 0 && voiceId < m_voices.size())
+    if (voiceId < 0 || voiceId >= m_voices.size()) {
+        setError(QTextToSpeech::ErrorReason::Configuration,
+                 QCoreApplication::translate("QTextToSpeech", "Invalid voiceId %1.").arg(voiceId));
+        return false;
+    }
+    if (acquiredVoice(voiceId))
         return true;
 
     setError(QTextToSpeech::ErrorReason::Configuration,
-             QCoreApplication::translate("QTextToSpeech", "Invalid voiceId %1.").arg(voiceId));
+             QCoreApplication::translate("QTextToSpeech", "Voice not available: %1")
+                .arg(m_voices.at(voiceId).name));
     return false;
 }
 
@@ -485,9 +940,11 @@ QAudio::State QTextToSpeechProcessorFlite::audioSinkState() const
 // Stop current and cancel subsequent utterances
 void QTextToSpeechProcessorFlite::stop()
 {
+    m_sentences.clear();
+    m_nextSentence = 0;
     if (audioSinkState() == QAudio::ActiveState || audioSinkState() == QAudio::SuspendedState) {
         deinitAudio();
-        // Call manual state change as audio sink has been deleted
+        // Call manual state change as the signals of the sink were blocked
         changeState(QAudio::StoppedState);
     }
 }
@@ -502,7 +959,7 @@ void QTextToSpeechProcessorFlite::resume()
 {
     if (audioSinkState() == QAudio::SuspendedState) {
         m_audioSink->resume();
-        // QAudioSink in push mode transitions to Idle when resumed, even if
+        // QAudioSink might transition to Idle when resumed, even if
         // there is still data to play. Workaround this weird behavior if we
         // know we are not done yet.
         changeState(QAudio::ActiveState);
@@ -518,7 +975,63 @@ void QTextToSpeechProcessorFlite::say(const QString &text, int voiceId, double p
         return;
 
     m_volume = volume;
-    processText(text, voiceId, pitch, rate, QTextToSpeechProcessorFlite::audioOutputCb);
+    m_sentences.clear();
+    m_nextSentence = 0;
+    m_sentenceStartTime = 0;
+
+    // Synthesize the text part by part, so that synthesis doesn't run further
+    // ahead of playback than one part. When streaming sentences, each sentence is
+    // a part, so that playback can start as soon as the first sentence is done.
+    // Tokens are looked up in the entire text, so the positions reported by
+    // sayingWord() refer to it.
+    m_text = text;
+    m_tokens.clear();
+    m_currentToken = 0;
+    m_index = 0;
+    const QList<QStringView> utterances = splitUtterances(text, m_sentenceStreaming);
+    for (const QStringView &utterance : utterances)
+        m_sentences.append(utterance.toString());
+    m_sentenceVoiceId = voiceId;
+    m_sentencePitch = pitch;
+    m_sentenceRate = rate;
+    sayNextSentence();
+}
+
+// Synthesize the next part of the text into the audio sink, and return to the event
+// loop before the one after, so that the sink and the token timer are serviced.
+void QTextToSpeechProcessorFlite::sayNextSentence()
+{
+    if (m_nextSentence >= m_sentences.size())
+        return;
+
+    const QString sentence = m_sentences.at(m_nextSentence++);
+    // the token times that flite reports are relative to the sentence
+    m_sentenceStartTime = m_nextSentence > 1 && m_format.isValid()
+                        ? totalBytes / m_format.bytesPerFrame() * 1000 / m_format.sampleRate()
+                        : 0;
+    if (synthesizeText(sentence, m_sentenceVoiceId, m_sentencePitch, m_sentenceRate,
+                       QTextToSpeechProcessorFlite::audioOutputCb) <= 0) {
+        m_sentences.clear();
+        m_nextSentence = 0;
+        setError(QTextToSpeech::ErrorReason::Input,
+                 QCoreApplication::translate("QTextToSpeech", "Speech synthesizing failure."));
+        return;
+    }
+
+    scheduleNextSentence();
+}
+
+// The next part is only synthesized once the sink has made room for all data of
+// the previous ones, so that synthesis doesn't run too far ahead of playback.
+void QTextToSpeechProcessorFlite::scheduleNextSentence()
+{
+    if (m_nextSentence >= m_sentences.size())
+        return;
+    // continued when the buffer is flushed
+    if (m_audioBuffer && m_audioBuffer->hasPending())
+        return;
+    QMetaObject::invokeMethod(this, &QTextToSpeechProcessorFlite::sayNextSentence,
+                              Qt::QueuedConnection);
 }
 
 void QTextToSpeechProcessorFlite::synthesize(const QString &text, int voiceId, double pitch, double rate, double volume)
@@ -533,4 +1046,419 @@ void QTextToSpeechProcessorFlite::synthesize(const QString &text, int voiceId, d
     processText(text, voiceId, pitch, rate, QTextToSpeechProcessorFlite::dataOutputCb);
 }
 
+void QTextToSpeechProcessorFlite::prepare(const QString &text, int voiceId, double pitch,
+                                          double rate)
+{
+    PreparedText prepared{text, voiceId, pitch, rate};
+    // errors are reported once the text gets spoken
+    if (!text.isEmpty() && voiceId >= 0 && voiceId < m_voices.size()) {
+        m_preparing = &prepared;
+        if (synthesizeText(text, voiceId, pitch, rate, preparedOutputCb) <= 0)
+            prepared.sampleRate = 0;
+        m_preparing = nullptr;
+    }
+    prepared.finished = true;
+    emit this->prepared(prepared);
+}
+
+void QTextToSpeechProcessorFlite::sayPrepared(const PreparedText &prepared, double volume)
+{
+    m_volume = volume;
+    m_sentences.clear();
+    m_nextSentence = 0;
+    m_sentenceStartTime = 0;
+    m_text = prepared.text;
+    m_tokens = prepared.tokens;
+    m_currentToken = 0;
+    m_index = 0;
+    if (!initAudio(prepared.sampleRate, prepared.channelCount) || !m_audioBuffer)
+        return;
+    m_audioBuffer->setUtteranceStretch(durationStretch(prepared.rate));
+
+    QByteArray data = prepared.data;
+    if (m_audioConverter) {
+        m_audioConverter->convert(prepared.data, m_convertedData, true);
+        data = m_convertedData;
+    }
+    // Prepared data usually exceeds the ring buffer; the buffer keeps the rest,
+    // without copying it, and the sink plays all of it
+    m_audioBuffer->append(data);
+    ++numberChunks;
+    totalBytes += data.size();
+    emit audioWritten(m_format, data.size());
+    m_audioBuffer->finish();
+}
+
+void QTextToSpeechProcessorFlite::synthesizeSegment(qsizetype segment, const QString &text,
+                                                    int voiceId, double pitch, double rate,
+                                                    double volume)
+{
+    // Always report the segment as finished, so that the engine can move on
+    // to delivering the next one.
+    auto finished = qScopeGuard([this, segment]{
+        emit segmentFinished(segment);
+    });
+
+    if (segment < m_firstValidSegment.load(std::memory_order_relaxed))
+        return;
+
+    if (text.isEmpty() || !checkVoice(voiceId))
+        return;
+
+    m_volume = volume;
+    m_segment = segment;
+    processText(text, voiceId, pitch, rate, QTextToSpeechProcessorFlite::dataOutputCb);
+    m_segment = -1;
+}
+
+void QTextToSpeechProcessorFlite::cancelSegments(qsizetype firstValidSegment)
+{
+    m_firstValidSegment.store(firstValidSegment, std::memory_order_relaxed);
+}
+
+// Blocks until the data pending in the engine leaves room for bytes more. Data of
+// the segment that the engine is delivering only has to wait for data that is in
+// transit to the engine, as data buffered for later segments can only be released
+// once that segment is done. Returns false if the segment got cancelled.
+bool QTextToSpeechFliteFlowControl::acquire(qint64 bytes, qsizetype segment,
+                                            const std::atomic<qsizetype> &firstValidSegment)
+{
+    QMutexLocker locker(&m_mutex);
+    const auto mustWait = [&]{
+        if (segment < firstValidSegment.load(std::memory_order_relaxed))
+            return false;
+        const qint64 pendingBytes = segment == m_deliveredSegment
+                                  ? m_pendingBytes - m_bufferedBytes
+                                  : m_pendingBytes;
+        return pendingBytes > 0 && pendingBytes + bytes > m_maxPendingBytes;
+    };
+    while (mustWait())
+        m_released.wait(&m_mutex);
+    if (segment < firstValidSegment.load(std::memory_order_relaxed))
+        return false;
+    m_pendingBytes += bytes;
+    return true;
+}
+
+void QTextToSpeechFliteFlowControl::release(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pendingBytes -= bytes;
+    m_released.wakeAll();
+}
+
+void QTextToSpeechFliteFlowControl::buffer(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_bufferedBytes += bytes;
+    m_released.wakeAll();
+}
+
+void QTextToSpeechFliteFlowControl::releaseBuffered(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_pendingBytes -= bytes;
+    m_bufferedBytes -= bytes;
+    m_released.wakeAll();
+}
+
+void QTextToSpeechFliteFlowControl::setDeliveredSegment(qsizetype segment)
+{
+    QMutexLocker locker(&m_mutex);
+    m_deliveredSegment = segment;
+    m_released.wakeAll();
+}
+
+QTextToSpeechFliteAudioBuffer::QTextToSpeechFliteAudioBuffer(qsizetype capacity,
+                                                             const QAudioFormat &format,
+                                                             const std::atomic<float> &playbackStretch,
+                                                             QObject *parent)
+    : QIODevice(parent),
+      m_capacity(qMax(capacity, qsizetype(4096))),
+      m_ring(std::make_unique<char[]>(m_capacity)),
+      m_format(format),
+      m_playbackStretch(playbackStretch),
+      m_stretcher(format)
+{
+    // readData() runs on the audio thread, and must not allocate memory. Each
+    // stretch step takes at most the content of the ring buffer.
+    if (m_stretcher.isValid()) {
+        const qsizetype frames = m_format.framesForBytes(m_capacity);
+        const qsizetype output = m_format.bytesForFrames(
+                qsizetype(frames / QTextToSpeechTimeStretcher::MinSpeed) + frames);
+        m_stretcher.reserve(frames);
+        m_stretchInput.reserve(m_capacity);
+        m_stretchOutput.reserve(output);
+        m_stretched.reserve(output);
+    }
+}
+
+// Moves as much data as fits into the ring buffer, returns the number of bytes moved
+qsizetype QTextToSpeechFliteAudioBuffer::push(const char *data, qsizetype size)
+{
+    const quint64 writePos = m_writePos.load(std::memory_order_relaxed);
+    const quint64 readPos = m_readPos.load(std::memory_order_acquire);
+    const qsizetype count = qMin(size, m_capacity - qsizetype(writePos - readPos));
+    const qsizetype offset = qsizetype(writePos % quint64(m_capacity));
+    const qsizetype first = qMin(count, m_capacity - offset);
+    memcpy(m_ring.get() + offset, data, first);
+    memcpy(m_ring.get(), data + first, count - first);
+    m_writePos.store(writePos + count, std::memory_order_release);
+    return count;
+}
+
+void QTextToSpeechFliteAudioBuffer::append(const char *data, qsizetype size)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    Q_ASSERT(!m_finishRequested);
+    if (m_pendingOffset < m_pending.size()) {
+        m_pending.append(data, size);
+        flushPending();
+        return;
+    }
+
+    const qsizetype written = push(data, size);
+    if (written < size) {
+        m_pending.append(data + written, size - written);
+        if (!m_flushTimer.isActive())
+            m_flushTimer.start(AudioBufferFlushInterval, this);
+    }
+}
+
+void QTextToSpeechFliteAudioBuffer::append(const QByteArray &data)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+    if (m_pendingOffset < m_pending.size()) {
+        append(data.constData(), data.size());
+        return;
+    }
+
+    Q_ASSERT(!m_finishRequested);
+    const qsizetype written = push(data.constData(), data.size());
+    if (written < data.size()) {
+        m_pending = data;
+        m_pendingOffset = written;
+        if (!m_flushTimer.isActive())
+            m_flushTimer.start(AudioBufferFlushInterval, this);
+    }
+}
+
+void QTextToSpeechFliteAudioBuffer::finish()
+{
+    m_finishRequested = true;
+    flushPending();
+}
+
+void QTextToSpeechFliteAudioBuffer::restart()
+{
+    Q_ASSERT(m_pendingOffset == m_pending.size());
+    m_finishRequested = false;
+    m_finished.store(false, std::memory_order_release);
+}
+
+void QTextToSpeechFliteAudioBuffer::flushPending()
+{
+    const bool hadPending = hasPending();
+    m_pendingOffset += push(m_pending.constData() + m_pendingOffset,
+                            m_pending.size() - m_pendingOffset);
+    if (m_pendingOffset < m_pending.size())
+        return;
+
+    m_pending.clear();
+    m_pendingOffset = 0;
+    m_flushTimer.stop();
+    if (hadPending)
+        emit flushed();
+    if (m_finishRequested && !m_finished.load(std::memory_order_relaxed)) {
+        m_finished.store(true, std::memory_order_release);
+        emit finished();
+    }
+}
+
+bool QTextToSpeechFliteAudioBuffer::isDrained() const
+{
+    return m_finished.load(std::memory_order_acquire)
+        && !m_stretchPending.load(std::memory_order_acquire)
+        && m_readPos.load(std::memory_order_acquire)
+            == m_writePos.load(std::memory_order_relaxed);
+}
+
+qint64 QTextToSpeechFliteAudioBuffer::bytesAvailable() const
+{
+    const quint64 writePos = m_writePos.load(std::memory_order_acquire);
+    return qint64(writePos - m_readPos.load(std::memory_order_relaxed))
+         + QIODevice::bytesAvailable();
+}
+
+// The ratio between the duration of the data as synthesized and as played
+double QTextToSpeechFliteAudioBuffer::speed() const
+{
+    if (!m_stretcher.isValid())
+        return 1;
+    return qBound(QTextToSpeechTimeStretcher::MinSpeed,
+                  double(m_utteranceStretch.load() / m_playbackStretch.load()),
+                  QTextToSpeechTimeStretcher::MaxSpeed);
+}
+
+qint64 QTextToSpeechFliteAudioBuffer::appendedBytes(qint64 outputBytes) const
+{
+    const qint64 sourcePos = qint64(m_sourcePos.load(std::memory_order_acquire));
+    const qint64 unplayed = qint64(m_outputPos.load(std::memory_order_acquire)) - outputBytes;
+    return qMax(sourcePos - qint64(qMax(unplayed, 0) * speed()), 0);
+}
+
+// Moves up to size bytes out of the ring buffer, returns the number of bytes moved
+qsizetype QTextToSpeechFliteAudioBuffer::pop(char *data, qsizetype size)
+{
+    const quint64 readPos = m_readPos.load(std::memory_order_relaxed);
+    const quint64 writePos = m_writePos.load(std::memory_order_acquire);
+    const qsizetype count = qsizetype(qMin(quint64(size), writePos - readPos));
+    const qsizetype offset = qsizetype(readPos % quint64(m_capacity));
+    const qsizetype first = qMin(count, m_capacity - offset);
+    memcpy(data, m_ring.get() + offset, first);
+    memcpy(data + first, m_ring.get(), count - first);
+    m_readPos.store(readPos + count, std::memory_order_release);
+    return count;
+}
+
+// Stretches data from the ring buffer until m_stretched holds maxlen bytes, or
+// the ring buffer is empty. The stretcher holds back some data until the end of
+// the utterance, after which data is read without stretching again.
+void QTextToSpeechFliteAudioBuffer::stretch(qint64 maxlen, double speed)
+{
+    m_stretchPending.store(true);
+    m_stretcher.setSpeed(speed);
+    const qsizetype bytesPerFrame = m_format.bytesPerFrame();
+    while (m_stretching && m_stretched.size() - m_stretchedOffset < maxlen) {
+        // all data has been appended if the buffer was finished before we look
+        const bool finished = m_finished.load(std::memory_order_acquire);
+        const qsizetype available = qsizetype(m_writePos.load(std::memory_order_acquire)
+                                              - m_readPos.load(std::memory_order_relaxed));
+        // enough input for the requested output
+        qsizetype size = qMin(available, qsizetype(maxlen * speed) + bytesPerFrame);
+        size -= size % bytesPerFrame;
+        const bool endOfStream = finished && size == available;
+        if (size == 0 && !endOfStream)
+            break;
+
+        m_stretchInput.resize(size);
+        pop(m_stretchInput.data(), size);
+        m_stretcher.process(m_stretchInput, m_stretchOutput, endOfStream);
+        m_stretched.append(m_stretchOutput);
+        m_stretching = !endOfStream;
+    }
+}
+
+// Called by the sink, usually from its audio thread
+qint64 QTextToSpeechFliteAudioBuffer::readData(char *data, qint64 maxlen)
+{
+    const double speed = this->speed();
+    // speed() is 1 if the format can't be stretched
+    if (!m_stretching && speed != 1
+        && m_readPos.load(std::memory_order_relaxed) != m_writePos.load(std::memory_order_acquire)) {
+        m_stretching = true;
+        m_stretchStart = m_readPos.load(std::memory_order_relaxed);
+    }
+    if (m_stretching)
+        stretch(maxlen, speed);
+
+    // Stretched data precedes the data in the ring buffer
+    qint64 count = qMin(maxlen, qint64(m_stretched.size() - m_stretchedOffset));
+    memcpy(data, m_stretched.constData() + m_stretchedOffset, count);
+    m_stretchedOffset += count;
+    if (m_stretchedOffset == m_stretched.size()) {
+        m_stretched.resize(0);
+        m_stretchedOffset = 0;
+    }
+    if (!m_stretching) {
+        // whole frames, so that stretching can start at any time
+        const qint64 size = maxlen - count;
+        count += pop(data + count, size - size % m_format.bytesPerFrame());
+    }
+
+    const quint64 sourcePos = m_stretching
+            ? m_stretchStart + quint64(m_format.bytesForFrames(m_stretcher.inputPosition()))
+            : m_readPos.load(std::memory_order_relaxed);
+    const qint64 held = m_stretched.size() - m_stretchedOffset;
+    m_sourcePos.store(sourcePos - qMin(quint64(held * speed), sourcePos),
+                      std::memory_order_relaxed);
+    m_outputPos.store(m_outputPos.load(std::memory_order_relaxed) + count,
+                      std::memory_order_release);
+    m_stretchPending.store(m_stretching || held > 0, std::memory_order_release);
+    return count;
+}
+
+qint64 QTextToSpeechFliteAudioBuffer::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
+
+void QTextToSpeechFliteAudioBuffer::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_flushTimer.timerId())
+        flushPending();
+    else
+        QIODevice::timerEvent(event);
+}
+
+// Split the text that say() synthesizes into the parts that get synthesized one
+// at a time: each sentence when streaming sentences, otherwise as many sentences
+// as fit into MaxUtteranceLength characters. Longer sentences are split between
+// words. The returned views reference text.
+QList<QStringView> QTextToSpeechProcessorFlite::splitUtterances(const QString &text,
+                                                                bool sentenceStreaming)
+{
+    QList<QStringView> pieces;
+    for (QStringView sentence : splitSentences(text)) {
+        while (sentence.size() > MaxUtteranceLength) {
+            qsizetype cut = MaxUtteranceLength;
+            while (cut > 0 && !sentence.at(cut).isSpace())
+                --cut;
+            if (cut == 0)
+                cut = MaxUtteranceLength;
+            if (const QStringView piece = sentence.first(cut); !piece.trimmed().isEmpty())
+                pieces.append(piece);
+            sentence = sentence.sliced(cut);
+        }
+        if (!sentence.trimmed().isEmpty())
+            pieces.append(sentence);
+    }
+    if (sentenceStreaming)
+        return pieces;
+
+    // the pieces are views into the text, in order
+    QList<QStringView> utterances;
+    for (const QStringView &piece : std::as_const(pieces)) {
+        if (!utterances.isEmpty()) {
+            QStringView &last = utterances.last();
+            const qsizetype length = piece.data() + piece.size() - last.data();
+            if (length <= MaxUtteranceLength) {
+                last = QStringView(last.data(), length);
+                continue;
+            }
+        }
+        utterances.append(piece);
+    }
+    return utterances;
+}
+
+// Split text into sentences, skipping segments that consist only of whitespace.
+// The returned views reference text.
+QList<QStringView> QTextToSpeechProcessorFlite::splitSentences(const QString &text)
+{
+    QList<QStringView> sentences;
+    QTextBoundaryFinder finder(QTextBoundaryFinder::Sentence, text);
+    qsizetype start = 0;
+    while (finder.toNextBoundary() != -1) {
+        const qsizetype end = finder.position();
+        const QStringView sentence = QStringView(text).sliced(start, end - start);
+        if (!sentence.trimmed().isEmpty())
+            sentences.append(sentence);
+        start = end;
+    }
+    return sentences;
+}
+
 QT_END_NAMESPACE
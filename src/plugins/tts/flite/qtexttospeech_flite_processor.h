@@ -7,12 +7,21 @@
 #include "qtexttospeechengine.h"
 #include "qvoice.h"
 
+#include <QtTextToSpeech/qtexttospeechprocessingchain.h>
+#include <QtTextToSpeech/private/qtexttospeechaudioconverter_p.h>
+#include <QtTextToSpeech/private/qtexttospeechtimestretcher_p.h>
+
 #include <QtCore/QList>
 #include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
 #include <QtCore/QLibrary>
 #include <QtCore/QString>
 #include <QtCore/QBasicTimer>
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QPointer>
 #include <QtCore/QTimerEvent>
 #include <QtCore/QAbstractEventDispatcher>
 #include <QtCore/QProcessEnvironment>
@@ -22,8 +31,163 @@
 
 #include <flite/flite.h>
 
+#include <atomic>
+#include <map>
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 
+// Limits the amount of synthesized data that has been emitted by the processors,
+// but not yet delivered by the engine. Processors block in acquire() until the
+// engine has released enough data.
+class QTextToSpeechFliteFlowControl
+{
+public:
+    explicit QTextToSpeechFliteFlowControl(qint64 maxPendingBytes)
+        : m_maxPendingBytes(maxPendingBytes)
+    {}
+
+    // called by the processors
+    bool acquire(qint64 bytes, qsizetype segment, const std::atomic<qsizetype> &firstValidSegment);
+
+    // called by the engine
+    void release(qint64 bytes);
+    void buffer(qint64 bytes);
+    void releaseBuffered(qint64 bytes);
+    void setDeliveredSegment(qsizetype segment);
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_released;
+    const qint64 m_maxPendingBytes;
+    // all data emitted and not yet delivered
+    qint64 m_pendingBytes = 0;
+    // data of segments that have to wait for previous segments
+    qint64 m_bufferedBytes = 0;
+    qsizetype m_deliveredSegment = 0;
+};
+
+// Voices registered with flite, shared by all processors of the process, as
+// every registered voice holds its own copy of the voice data. A voice gets
+// registered when the first processor acquires it, and unregistered when the
+// last processor releases it. Processors only modify the features of their
+// utterances, so a voice can be used by several threads at the same time.
+class QTextToSpeechFliteVoiceRegistry
+{
+public:
+    // Thread-safe; returns nullptr if the voice could not be registered
+    cst_voice *acquire(int id, const QString &name, const QString &langCode);
+    void release(int id);
+
+private:
+    struct Voice
+    {
+        std::unique_ptr<QLibrary> library;
+        cst_voice *vox = nullptr;
+        void (*unregister_func)(cst_voice *vox) = nullptr;
+        std::atomic<int> refCount = 0;
+    };
+    static bool registerVoice(const QString &name, const QString &langCode, Voice &voice);
+    static void unregisterVoice(Voice &voice);
+
+    QReadWriteLock m_lock;
+    std::map<int, Voice> m_voices;
+};
+
+// The device from which the audio sink pulls the data that flite synthesizes.
+// The data is passed through a single-producer, single-consumer ring buffer,
+// so that the sink can read from its own thread without locking. append()
+// never blocks the processor's thread, which has to handle stop(), pause(),
+// and the token timer: data that doesn't fit into the ring buffer is kept
+// aside, and moved into the ring buffer from a timer as the sink makes room.
+// The processor synthesizes texts in parts of limited length, and waits for
+// flushed() before it synthesizes the next part, so that the data kept aside
+// is bounded by the data of one part.
+// If the playback rate differs from the rate that the data was synthesized
+// with, the sink reads the data through a time stretcher, so that rate changes
+// apply to data that is already in the buffer.
+class QTextToSpeechFliteAudioBuffer : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    // playbackStretch is the duration stretch of the playback rate, and can be
+    // changed by any thread while the buffer exists
+    QTextToSpeechFliteAudioBuffer(qsizetype capacity, const QAudioFormat &format,
+                                  const std::atomic<float> &playbackStretch,
+                                  QObject *parent = nullptr);
+
+    // called by the processor's thread; append() takes all data, however much
+    // exceeds the capacity of the ring buffer. Data that is kept aside is shared
+    // with the QByteArray, rather than copied.
+    void append(const char *data, qsizetype size);
+    void append(const QByteArray &data);
+    void finish();
+    // accepts data again after finish(), for the next utterance
+    void restart();
+    bool isDrained() const;
+    // data has been kept aside, because the ring buffer was full
+    bool hasPending() const { return m_pendingOffset < m_pending.size(); }
+    // the duration stretch that the appended data has been synthesized with
+    void setUtteranceStretch(float stretch) { m_utteranceStretch.store(stretch); }
+    double speed() const;
+    // The number of appended bytes that correspond to the first outputBytes that
+    // the sink has read; an estimate while the data is stretched
+    qint64 appendedBytes(qint64 outputBytes) const;
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+Q_SIGNALS:
+    // all data has been appended, and the ring buffer has room for it
+    void finished();
+    // all data that had been kept aside has been moved into the ring buffer
+    void flushed();
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    qsizetype push(const char *data, qsizetype size);
+    qsizetype pop(char *data, qsizetype size);
+    void flushPending();
+    void stretch(qint64 maxlen, double speed);
+
+    const qsizetype m_capacity;
+    const std::unique_ptr<char[]> m_ring;
+    // total number of bytes written to and read from the ring buffer
+    std::atomic<quint64> m_writePos = 0;
+    std::atomic<quint64> m_readPos = 0;
+    std::atomic<bool> m_finished = false;
+
+    // data that didn't fit into the ring buffer; only used by the processor's thread
+    QByteArray m_pending;
+    qsizetype m_pendingOffset = 0;
+    bool m_finishRequested = false;
+    QBasicTimer m_flushTimer;
+
+    // Time-stretching; the stretcher and the data it produced, that the sink
+    // has not read yet, are only used by the reader
+    const QAudioFormat m_format;
+    const std::atomic<float> &m_playbackStretch;
+    std::atomic<float> m_utteranceStretch = 1;
+    QTextToSpeechTimeStretcher m_stretcher;
+    bool m_stretching = false;
+    quint64 m_stretchStart = 0;
+    QByteArray m_stretchInput;
+    QByteArray m_stretchOutput;
+    QByteArray m_stretched;
+    qsizetype m_stretchedOffset = 0;
+    // stretched data is held back, and can't be replaced by the next utterance
+    std::atomic<bool> m_stretchPending = false;
+    // total number of bytes read by the sink, and the corresponding position in
+    // the appended data
+    std::atomic<quint64> m_outputPos = 0;
+    std::atomic<quint64> m_sourcePos = 0;
+};
+
 class QTextToSpeechProcessorFlite : public QObject
 {
     Q_OBJECT
@@ -35,12 +199,30 @@ public:
     struct VoiceInfo
     {
         int id;
-        cst_voice *vox;
-        void (*unregister_func)(cst_voice *vox);
         QString name;
         QString locale;
         QVoice::Gender gender;
         QVoice::Age age;
+        QString langCode;
+    };
+
+    struct TokenData {
+        qint64 startTime;
+        QString text;
+    };
+
+    // Audio data and tokens of a text that got synthesized before being spoken
+    struct PreparedText
+    {
+        QString text;
+        int voiceId = -1;
+        double pitch = 0;
+        double rate = 0;
+        bool finished = false;
+        int sampleRate = 0;
+        int channelCount = 0;
+        QByteArray data;
+        QList<TokenData> tokens;
     };
 
     Q_INVOKABLE void say(const QString &text, int voiceId, double pitch, double rate, double volume);
@@ -49,8 +231,36 @@ public:
     Q_INVOKABLE void resume();
     Q_INVOKABLE void stop();
 
+    // Synthesize a text ahead of time, the result is emitted by prepared()
+    void prepare(const QString &text, int voiceId, double pitch, double rate);
+    // Play a text synthesized by prepare()
+    void sayPrepared(const QTextToSpeechProcessorFlite::PreparedText &prepared, double volume);
+
+    // Synthesize one segment of a text as part of a parallel synthesis job
+    void synthesizeSegment(qsizetype segment, const QString &text, int voiceId,
+                           double pitch, double rate, double volume);
+    // Thread-safe; segments with a lower number will be skipped or aborted
+    void cancelSegments(qsizetype firstValidSegment);
+    // Must be set before the processor is moved to its thread
+    void setFlowControl(QTextToSpeechFliteFlowControl *flowControl) { m_flowControl = flowControl; }
+    void setSentenceStreaming(bool enabled) { m_sentenceStreaming = enabled; }
+    // Voices that have not been used for that many milliseconds get unregistered
+    void setVoiceIdleTimeout(int msecs) { m_voiceIdleTimeout = msecs; }
+    // The audio sink gets closed once it has not played anything for that many milliseconds
+    void setAudioIdleTimeout(int msecs) { m_audioIdleTimeout = msecs; }
+    // Thread-safe; applies the rate to the data that is played, without synthesizing it again
+    void setPlaybackRate(double rate);
+    // The format in which synthesized data gets emitted, if different from flite's
+    void setSynthesisFormat(const QAudioFormat &format) { m_synthesisFormat = format; }
+    // Processes the data before it gets emitted or played; each processor has its own copy
+    void setProcessingChain(const QTextToSpeechProcessingChain &chain) { m_processingChain = chain; }
+
     const QList<QTextToSpeechProcessorFlite::VoiceInfo> &voices() const;
+    // Scans the library paths for voices once per process; thread-safe
+    static QList<VoiceInfo> discoverVoices();
     static constexpr QTextToSpeech::State audioStateToTts(QAudio::State audioState);
+    static QList<QStringView> splitSentences(const QString &text);
+    static QList<QStringView> splitUtterances(const QString &text, bool sentenceStreaming);
 
 private:
     // Flite callbacks
@@ -58,15 +268,38 @@ private:
                              int last, cst_audio_streaming_info *asi);
     static int dataOutputCb(const cst_wave *w, int start, int size,
                             int last, cst_audio_streaming_info *asi);
+    static int preparedOutputCb(const cst_wave *w, int start, int size,
+                                int last, cst_audio_streaming_info *asi);
+    static bool readToken(const cst_wave *w, int start, int size,
+                          cst_audio_streaming_info *asi, QList<TokenData> &tokens);
 
     using OutputHandler = decltype(QTextToSpeechProcessorFlite::audioOutputCb);
     // Process a single text
     void processText(const QString &text, int voiceId, double pitch, double rate, OutputHandler outputHandler);
+    float synthesizeText(const QString &text, int voiceId, double pitch, double rate,
+                         OutputHandler outputHandler);
+    void sayNextSentence();
+    void scheduleNextSentence();
     int audioOutput(const cst_wave *w, int start, int size, int last, cst_audio_streaming_info *asi);
     int dataOutput(const cst_wave *w, int start, int size, int last, cst_audio_streaming_info *asi);
+    int preparedOutput(const cst_wave *w, int start, int size, int last, cst_audio_streaming_info *asi);
+    void reportWord(const QString &word);
+    QByteArray &pooledBuffer();
+    QByteArrayView processChunk(const cst_wave *w, int start, int size, bool first, bool last);
+    qint64 droppedTime(const cst_wave *w) const;
+
+    // Voices are acquired from the voice registry when they are first used
+    struct AcquiredVoice
+    {
+        cst_voice *vox = nullptr;
+        qint64 lastUsed = 0;
+    };
+    cst_voice *acquiredVoice(int voiceId);
+    void releaseIdleVoices();
 
-    void setRateForVoice(cst_voice *voice, float rate);
-    void setPitchForVoice(cst_voice *voice, float pitch);
+    static float durationStretch(double rate);
+    static void setRateForUtterance(cst_utterance *utterance, float rate);
+    static void setPitchForUtterance(cst_utterance *utterance, float pitch);
 
     bool init();
     bool initAudio(double rate, int channelCount);
@@ -75,11 +308,12 @@ private:
     bool checkVoice(int voiceId);
     void deleteSink();
     void createSink();
+    void audioBufferFinished();
     QAudio::State audioSinkState() const;
     void setError(QTextToSpeech::ErrorReason err, const QString &errorString = QString());
 
     // Read available flite voices
-    QStringList fliteAvailableVoices(const QString &libPrefix, const QString &langCode) const;
+    static QStringList fliteAvailableVoices(const QString &libPrefix, const QString &langCode);
 
 private slots:
     void changeState(QAudio::State newState);
@@ -89,31 +323,79 @@ Q_SIGNALS:
     void stateChanged(QTextToSpeech::State);
     void sayingWord(const QString &word, qsizetype begin, qsizetype length);
     void synthesized(const QAudioFormat &format, const QByteArray &array);
+    void audioWritten(const QAudioFormat &format, qint64 bytes);
+    void segmentSynthesized(qsizetype segment, const QAudioFormat &format, const QByteArray &array);
+    void segmentWord(qsizetype segment, const QString &word, qsizetype begin, qsizetype length);
+    void segmentFinished(qsizetype segment);
+    void prepared(const QTextToSpeechProcessorFlite::PreparedText &prepared);
 
 protected:
     void timerEvent(QTimerEvent *event) override;
 
 private:
-    struct TokenData {
-        qint64 startTime;
-        QString text;
-    };
     QString m_text;
     qsizetype m_index = -1;
     QList<TokenData> m_tokens;
     qsizetype m_currentToken = -1;
     QBasicTimer m_tokenTimer;
     void startTokenTimer();
+    void retimeTokens();
 
-    QAudioSink *m_audioSink = nullptr;
+    // Parts of the text passed to say() that remain to be synthesized, and the
+    // time at which the current part starts playing
+    bool m_sentenceStreaming = false;
+    QStringList m_sentences;
+    qsizetype m_nextSentence = 0;
+    qint64 m_sentenceStartTime = 0;
+    int m_sentenceVoiceId = -1;
+    double m_sentencePitch = 0;
+    double m_sentenceRate = 0;
+
+    // deleted by deleteSink(), or when the processor's thread finishes
+    QPointer<QAudioSink> m_audioSink;
     QAudio::State m_state = QAudio::IdleState;
-    QIODevice *m_audioBuffer = nullptr;
+    // set by setPlaybackRate(), read by the buffer
+    std::atomic<float> m_playbackStretch = 1;
+    std::unique_ptr<QTextToSpeechFliteAudioBuffer> m_audioBuffer;
+    // The sink stays open between utterances with the same format; data of
+    // previous utterances that the sink has played, and the idle timeout
+    qint64 m_playedBytes = 0;
+    QBasicTimer m_audioIdleTimer;
+    int m_audioIdleTimeout = 0;
 
     QAudioDevice m_audioDevice;
     QAudioFormat m_format;
+    // Converts flite's data if the device doesn't support its format
+    std::unique_ptr<QTextToSpeechAudioConverter> m_audioConverter;
+    QByteArray m_convertedData;
     double m_volume = 1;
 
+    // Format and recycled buffers for data emitted by synthesized()
+    QAudioFormat m_dataFormat;
+    QAudioFormat m_synthesisFormat;
+    std::unique_ptr<QTextToSpeechAudioConverter> m_dataConverter;
+
+    QTextToSpeechProcessingChain m_processingChain;
+    // data of the current utterance that the processing chain dropped
+    qint64 m_droppedBytes = 0;
+    static constexpr qsizetype MaxPooledBuffers = 16;
+    QList<QByteArray> m_bufferPool;
+    QByteArray m_unpooledBuffer;
+
     QList<VoiceInfo> m_voices;
+    std::map<int, AcquiredVoice> m_acquiredVoices;
+    QBasicTimer m_voiceIdleTimer;
+    int m_voiceIdleTimeout = 0;
+
+    // Text currently synthesized by prepare(), and the time at which its
+    // current utterance starts, in milliseconds
+    PreparedText *m_preparing = nullptr;
+    qint64 m_preparingOffset = 0;
+
+    // Segment currently synthesized by synthesizeSegment(), or -1
+    qsizetype m_segment = -1;
+    std::atomic<qsizetype> m_firstValidSegment = 0;
+    QTextToSpeechFliteFlowControl *m_flowControl = nullptr;
 
     // Statistics for debugging
     qint64 numberChunks = 0;
@@ -16,6 +16,16 @@ QTextToSpeechEngineMock::QTextToSpeechEngineMock(const QVariantMap &parameters,
 {
     m_locale = availableLocales().first();
     m_voice = availableVoices().first();
+    m_format.setSampleRate(22050);
+    m_format.setChannelConfig(QAudioFormat::ChannelConfigMono);
+    m_format.setSampleFormat(QAudioFormat::Int16);
+    // simulates a voice getting installed while the engine is in use
+    if (const auto it = m_parameters.find("installedVoice"); it != m_parameters.constEnd()) {
+        QTimer::singleShot(50, this, [this, voiceData = it->value<VoiceData>()]{
+            m_installedVoices << voiceData;
+            emit voicesChanged();
+        });
+    }
     if (m_parameters[u"delayedInitialization"_s].toBool()) {
         QTimer::singleShot(50, this, [this]{
             m_state = QTextToSpeech::Ready;
@@ -35,11 +45,9 @@ QList<QLocale> QTextToSpeechEngineMock::availableLocales() const
 {
     QList<QLocale> locales;
 
-    if (const auto it = m_parameters.find("voices"); it != m_parameters.constEnd()) {
-        using VoiceData = QList<std::tuple<QString, QLocale, QVoice::Gender, QVoice::Age>>;
-        const auto voicesData = it->value<VoiceData>();
+    if (m_parameters.contains("voices")) {
         QSet<QLocale> localeSet;
-        for (const auto &voiceData : voicesData)
+        for (const auto &voiceData : voicesData())
             localeSet.insert(std::get<1>(voiceData));
         locales = localeSet.values();
     } else {
@@ -54,31 +62,49 @@ QList<QLocale> QTextToSpeechEngineMock::availableLocales() const
 }
 
 QList<QVoice> QTextToSpeechEngineMock::availableVoices() const
+{
+    return voicesForLocale(m_locale);
+}
+
+QList<QVoice> QTextToSpeechEngineMock::allVoices() const
+{
+    QList<QVoice> voices;
+    const QList<QLocale> locales = availableLocales();
+    for (const QLocale &locale : locales)
+        voices << voicesForLocale(locale);
+    return voices;
+}
+
+QList<QTextToSpeechEngineMock::VoiceData> QTextToSpeechEngineMock::voicesData() const
+{
+    return m_parameters.value("voices").value<QList<VoiceData>>() + m_installedVoices;
+}
+
+QList<QVoice> QTextToSpeechEngineMock::voicesForLocale(const QLocale &locale) const
 {
     QList<QVoice> voices;
 
-    if (const auto it = m_parameters.find("voices"); it != m_parameters.constEnd()) {
-        const auto voicesData = it->value<QList<std::tuple<QString, QLocale, QVoice::Gender, QVoice::Age>>>();
-        for (const auto &voiceData : voicesData) {
+    if (m_parameters.contains("voices")) {
+        for (const auto &voiceData : voicesData()) {
             const QLocale &voiceLocale = std::get<1>(voiceData);
-            if (voiceLocale == m_locale) {
+            if (voiceLocale == locale) {
                 voices << createVoice(std::get<0>(voiceData),
                                       voiceLocale,
                                       std::get<2>(voiceData),
                                       std::get<3>(voiceData),
-                                      u"%1-%2"_s.arg(m_locale.bcp47Name()).arg(voices.count() + 1));
+                                      u"%1-%2"_s.arg(locale.bcp47Name()).arg(voices.count() + 1));
             }
         }
     } else {
-        const QString voiceData = m_locale.bcp47Name();
-        const auto newVoice = [this, &voiceData](const QString &name, QVoice::Gender gender,
+        const QString voiceData = locale.bcp47Name();
+        const auto newVoice = [&locale, &voiceData](const QString &name, QVoice::Gender gender,
                                   QVoice::Age age, const char *suffix) {
-            return createVoice(name, m_locale, gender, age,
+            return createVoice(name, locale, gender, age,
                                QVariant::fromValue<QString>(voiceData + suffix));
         };
-        switch (m_locale.language()) {
+        switch (locale.language()) {
         case QLocale::English: {
-            if (m_locale.territory() == QLocale::UnitedKingdom) {
+            if (locale.territory() == QLocale::UnitedKingdom) {
                 voices << newVoice("Bob", QVoice::Male, QVoice::Adult, "-1")
                        << newVoice("Anne", QVoice::Female, QVoice::Adult, "-2");
             } else {
@@ -100,7 +126,7 @@ QList<QVoice> QTextToSpeechEngineMock::availableVoices() const
                    << newVoice("Anneli", QVoice::Female, QVoice::Adult, "-2");
             break;
         default:
-            Q_ASSERT_X(false, "availableVoices", "Unsupported locale!");
+            Q_ASSERT_X(false, "voicesForLocale", "Unsupported locale!");
             break;
         }
     }
@@ -109,38 +135,61 @@ QList<QVoice> QTextToSpeechEngineMock::availableVoices() const
 
 void QTextToSpeechEngineMock::say(const QString &text)
 {
+    finishStop();
     m_text = text;
     m_currentIndex = 0;
-    m_timer.start(wordTime(), Qt::PreciseTimer, this);
+    m_timer.start(wordInterval(), Qt::PreciseTimer, this);
     m_state = QTextToSpeech::Speaking;
     emit stateChanged(m_state);
 }
 
 void QTextToSpeechEngineMock::synthesize(const QString &text)
 {
+    finishStop();
+    m_batch.clear();
+    m_batchIndex = -1;
     m_text = text;
     m_currentIndex = 0;
-    m_timer.start(wordTime(), Qt::PreciseTimer, this);
+    m_timer.start(wordInterval(), Qt::PreciseTimer, this);
     m_state = QTextToSpeech::Synthesizing;
     emit stateChanged(m_state);
+}
 
-    m_format.setSampleRate(22050);
-    m_format.setChannelConfig(QAudioFormat::ChannelConfigMono);
-    m_format.setSampleFormat(QAudioFormat::Int16);
+bool QTextToSpeechEngineMock::synthesizeBatch(const QStringList &texts)
+{
+    synthesize(texts.first());
+    m_batch = texts;
+    m_batchIndex = 0;
+    return true;
 }
 
 void QTextToSpeechEngineMock::stop(QTextToSpeech::BoundaryHint boundaryHint)
 {
     Q_UNUSED(boundaryHint);
-    if (m_state == QTextToSpeech::Ready || m_state == QTextToSpeech::Error)
+    if (m_state == QTextToSpeech::Ready || m_state == QTextToSpeech::Error || m_stopPending)
         return;
 
     Q_ASSERT(m_state == QTextToSpeech::Paused || m_timer.isActive());
     // finish immediately
+    m_batch.clear();
+    m_batchIndex = -1;
     m_text.clear();
     m_currentIndex = -1;
     m_timer.stop();
 
+    // the "asynchronousStop" parameter simulates engines that report the end of
+    // the stopped text later, at the latest before they start the next one
+    m_stopPending = true;
+    if (m_parameters.value(u"asynchronousStop"_s).toBool())
+        QTimer::singleShot(0, this, &QTextToSpeechEngineMock::finishStop);
+    else
+        finishStop();
+}
+
+void QTextToSpeechEngineMock::finishStop()
+{
+    if (!std::exchange(m_stopPending, false))
+        return;
     m_state = QTextToSpeech::Ready;
     emit stateChanged(m_state);
 }
@@ -160,7 +209,7 @@ void QTextToSpeechEngineMock::resume()
     if (m_state != QTextToSpeech::Paused)
         return;
 
-    m_timer.start(wordTime(), Qt::PreciseTimer, this);
+    m_timer.start(wordInterval(), Qt::PreciseTimer, this);
     m_state = QTextToSpeech::Speaking;
     emit stateChanged(m_state);
 }
@@ -184,7 +233,25 @@ void QTextToSpeechEngineMock::timerEvent(QTimerEvent *e)
     sayingWord(word, m_currentIndex, nextSpace - m_currentIndex);
     m_currentIndex = nextSpace + match.captured().length();
 
-    emit synthesized(m_format, QByteArray(m_format.bytesForDuration(wordTime() * 1000), 0));
+    const qint32 bytes = m_format.bytesForDuration(wordTime() * 1000);
+    emit synthesized(m_format, QByteArray(bytes, 0));
+    if (m_state == QTextToSpeech::Speaking)
+        emit audioWritten(m_format, bytes);
+
+    if (m_currentIndex >= m_text.length() && m_batchIndex >= 0) {
+        // continue with the next text of the batch without becoming ready
+        emit utteranceSynthesized(m_batchIndex);
+        // a receiver might have stopped us, or started a new text
+        if (m_state != QTextToSpeech::Synthesizing || m_currentIndex < m_text.length())
+            return;
+        if (++m_batchIndex < m_batch.size()) {
+            m_text = m_batch.at(m_batchIndex);
+            m_currentIndex = 0;
+            return;
+        }
+        m_batch.clear();
+        m_batchIndex = -1;
+    }
 
     if (m_currentIndex >= m_text.length()) {
         // done speaking all words
@@ -210,7 +277,7 @@ bool QTextToSpeechEngineMock::setRate(double rate)
     m_rate = rate;
     if (m_timer.isActive()) {
         m_timer.stop();
-        m_timer.start(wordTime(), Qt::PreciseTimer, this);
+        m_timer.start(wordInterval(), Qt::PreciseTimer, this);
     }
     return true;
 }
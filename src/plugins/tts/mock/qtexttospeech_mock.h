@@ -19,9 +19,11 @@ public:
 
     QList<QLocale> availableLocales() const override;
     QList<QVoice> availableVoices() const override;
+    QList<QVoice> allVoices() const override;
 
     void say(const QString &text) override;
     void synthesize(const QString &text) override;
+    bool synthesizeBatch(const QStringList &texts) override;
     void stop(QTextToSpeech::BoundaryHint boundaryHint) override;
     void pause(QTextToSpeech::BoundaryHint boundaryHint) override;
     void resume() override;
@@ -44,8 +46,19 @@ protected:
     void timerEvent(QTimerEvent *e) override;
 
 private:
+    // the voices from the "voices" parameter, and installed voices
+    using VoiceData = std::tuple<QString, QLocale, QVoice::Gender, QVoice::Age>;
+    QList<VoiceData> voicesData() const;
+    QList<QVoice> voicesForLocale(const QLocale &locale) const;
+    void finishStop();
+
     // mock engine uses 100ms per word, +/- 50ms depending on rate
     int wordTime() const { return 100 - int(50.0 * m_rate); }
+    // the "wordInterval" parameter lets benchmarks run faster than real time
+    int wordInterval() const
+    {
+        return m_parameters.value(QStringLiteral("wordInterval"), wordTime()).toInt();
+    }
 
     const QVariantMap m_parameters;
     QString m_text;
@@ -59,8 +72,12 @@ private:
     QTextToSpeech::ErrorReason m_errorReason = QTextToSpeech::ErrorReason::Initialization;
     QString m_errorString;
     bool m_pauseRequested = false;
+    bool m_stopPending = false;
     qsizetype m_currentIndex = -1;
+    QStringList m_batch;
+    qsizetype m_batchIndex = -1;
     QAudioFormat m_format;
+    QList<VoiceData> m_installedVoices;
 };
 
 QT_END_NAMESPACE
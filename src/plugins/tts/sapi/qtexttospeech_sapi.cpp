@@ -471,6 +471,16 @@ QList<QVoice> QTextToSpeechEngineSapi::availableVoices() const
     return m_voices.values(locale());
 }
 
+QList<QVoice> QTextToSpeechEngineSapi::allVoices() const
+{
+    QList<QVoice> voices;
+    voices.reserve(m_voices.size());
+    const QList<QLocale> locales = availableLocales();
+    for (const QLocale &locale : locales)
+        voices << m_voices.values(locale);
+    return voices;
+}
+
 bool QTextToSpeechEngineSapi::setVoice(const QVoice &voice)
 {
     // Convert voice id to null-terminated wide char string
@@ -7,6 +7,7 @@
 #include <QtCore/QDebug>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QLoggingCategory>
+#include <QtCore/QMutex>
 
 #include <libspeechd.h>
 
@@ -18,8 +19,27 @@ QT_BEGIN_NAMESPACE
 
 Q_LOGGING_CATEGORY(lcSpeechTtsSpeechd, "qt.speech.tts.speechd")
 
-typedef QList<QTextToSpeechEngineSpeechd*> QTextToSpeechSpeechDispatcherBackendList;
-Q_GLOBAL_STATIC(QTextToSpeechSpeechDispatcherBackendList, backends)
+// The engine that said each message, so that the events of a message are only
+// delivered to that engine. Events that arrive before spd_say() has returned the
+// id of the message are kept until the engine claims them.
+struct QTextToSpeechSpeechDispatcherMessages
+{
+    QMutex mutex;
+    QHash<size_t, QTextToSpeechEngineSpeechd *> owners;
+    QHash<size_t, QList<SPDNotificationType>> unclaimed;
+    size_t lastMessage = 0;
+};
+Q_GLOBAL_STATIC(QTextToSpeechSpeechDispatcherMessages, messages)
+
+// The voices of each output module, shared by all engines of the process. The cache
+// is dropped when a connection lists a different set of modules.
+struct QTextToSpeechSpeechDispatcherVoiceCache
+{
+    QMutex mutex;
+    QList<QByteArray> modules;
+    QHash<QByteArray, QList<QVoice>> voices;
+};
+Q_GLOBAL_STATIC(QTextToSpeechSpeechDispatcherVoiceCache, voiceCache)
 
 void speech_finished_callback(size_t msg_id, size_t client_id, SPDNotificationType state);
 
@@ -36,7 +56,6 @@ QLocale QTextToSpeechEngineSpeechd::localeForVoice(SPDVoice *voice) const
 QTextToSpeechEngineSpeechd::QTextToSpeechEngineSpeechd(const QVariantMap &, QObject *)
     : speechDispatcher(nullptr)
 {
-    backends->append(this);
     connectToSpeechDispatcher();
 }
 
@@ -44,10 +63,13 @@ QTextToSpeechEngineSpeechd::~QTextToSpeechEngineSpeechd()
 {
     if (speechDispatcher) {
         if ((m_state != QTextToSpeech::Error) && (m_state != QTextToSpeech::Ready))
-            spd_cancel_all(speechDispatcher);
+            spd_cancel(speechDispatcher);
         spd_close(speechDispatcher);
     }
-    backends->removeAll(this);
+    QMutexLocker locker(&messages->mutex);
+    messages->owners.removeIf([this](QHash<size_t, QTextToSpeechEngineSpeechd *>::iterator it) {
+        return it.value() == this;
+    });
 }
 
 bool QTextToSpeechEngineSpeechd::connectToSpeechDispatcher()
@@ -73,22 +95,14 @@ bool QTextToSpeechEngineSpeechd::connectToSpeechDispatcher()
     speechDispatcher->callback_pause = speech_finished_callback;
     spd_set_notification_on(speechDispatcher, SPD_PAUSE);
 
-    QStringList availableModules;
-    char **modules = spd_list_modules(speechDispatcher);
-    int i = 0;
-    while (modules && modules[i]) {
-        availableModules.append(QString::fromUtf8(modules[i]));
-        ++i;
-    }
-
-    if (availableModules.length() == 0) {
+    updateVoices();
+    if (m_pendingModules.isEmpty()) {
         setError(QTextToSpeech::ErrorReason::Configuration,
                     QCoreApplication::translate("QTextToSpeech",
                                                 "Found no modules in speech-dispatcher."));
         return false;
     }
 
-    updateVoices();
     if (m_currentVoice == QVoice()) {
         // Set the default locale (which is usually the system locale), and fall back
         // to a locale that has the same language if that fails. That might then still fail,
@@ -108,19 +122,112 @@ bool QTextToSpeechEngineSpeechd::connectToSpeechDispatcher()
     return true;
 }
 
-// hack to get state notifications
-void QTextToSpeechEngineSpeechd::spdStateChanged(SPDNotificationType state)
+void QTextToSpeechSpeechdEventQueue::push(const Event &event)
+{
+    if (!m_overflowed.load(std::memory_order_acquire)) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) < Capacity) {
+            m_ring[tail % Capacity] = event;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return;
+        }
+    }
+
+    QMutexLocker locker(&m_overflowMutex);
+    m_overflow.append(event);
+    m_overflowed.store(true, std::memory_order_release);
+}
+
+bool QTextToSpeechSpeechdEventQueue::pop(Event &event)
 {
-    QTextToSpeech::State s = QTextToSpeech::Error;
-    if (state == SPD_EVENT_PAUSE)
-        s = QTextToSpeech::Paused;
-    else if ((state == SPD_EVENT_BEGIN) || (state == SPD_EVENT_RESUME))
-        s = QTextToSpeech::Speaking;
-    else if ((state == SPD_EVENT_CANCEL) || (state == SPD_EVENT_END))
-        s = QTextToSpeech::Ready;
+    if (m_spilledIndex < m_spilled.size()) {
+        event = m_spilled.at(m_spilledIndex++);
+        return true;
+    }
+
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head != m_tail.load(std::memory_order_acquire)) {
+        event = m_ring[head % Capacity];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // the ring is empty, so the events in the overflow list are the oldest ones
+    if (!m_overflowed.load(std::memory_order_acquire))
+        return false;
+    {
+        QMutexLocker locker(&m_overflowMutex);
+        m_spilled = std::exchange(m_overflow, {});
+        m_spilledIndex = 0;
+        m_overflowed.store(false, std::memory_order_release);
+    }
+    return pop(event);
+}
 
-    if (m_state != s) {
-        m_state = s;
+// Called from the thread of the speech-dispatcher connection
+void QTextToSpeechEngineSpeechd::postEvent(size_t messageId, SPDNotificationType type)
+{
+    m_events.push({messageId, type});
+    // a burst of events is processed at once
+    if (!m_eventsPosted.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &QTextToSpeechEngineSpeechd::processEvents,
+                                  Qt::QueuedConnection);
+    }
+}
+
+/*
+    Processes all queued events, and only reports the resulting state. Events
+    of messages that have been replaced by a later say() are dropped, and so
+    are intermediate pauses. A message that started and finished within the
+    same batch of events is still reported as Speaking, and then as Ready.
+*/
+void QTextToSpeechEngineSpeechd::processEvents()
+{
+    m_eventsPosted.store(false, std::memory_order_release);
+
+    QTextToSpeech::State state = m_state;
+    bool started = false;
+    QTextToSpeechSpeechdEventQueue::Event event;
+    while (m_events.pop(event))
+        processEvent(event, state, started);
+    updateState(state, started);
+}
+
+void QTextToSpeechEngineSpeechd::processEvent(const QTextToSpeechSpeechdEventQueue::Event &event,
+                                              QTextToSpeech::State &state, bool &started) const
+{
+    if (event.messageId != m_currentMessage)
+        return;
+
+    switch (event.type) {
+    case SPD_EVENT_PAUSE:
+        state = QTextToSpeech::Paused;
+        break;
+    case SPD_EVENT_BEGIN:
+        started = true;
+        state = QTextToSpeech::Speaking;
+        break;
+    case SPD_EVENT_RESUME:
+        state = QTextToSpeech::Speaking;
+        break;
+    case SPD_EVENT_CANCEL:
+    case SPD_EVENT_END:
+        state = QTextToSpeech::Ready;
+        break;
+    default:
+        state = QTextToSpeech::Error;
+        break;
+    }
+}
+
+void QTextToSpeechEngineSpeechd::updateState(QTextToSpeech::State state, bool started)
+{
+    if (started && m_state != QTextToSpeech::Speaking && state != QTextToSpeech::Speaking) {
+        m_state = QTextToSpeech::Speaking;
+        emit stateChanged(m_state);
+    }
+    if (m_state != state) {
+        m_state = state;
         emit stateChanged(m_state);
     }
 }
@@ -149,9 +256,38 @@ void QTextToSpeechEngineSpeechd::say(const QString &text)
     if (m_state != QTextToSpeech::Ready)
         stop(QTextToSpeech::BoundaryHint::Default);
 
-    if (spd_say(speechDispatcher, SPD_MESSAGE, text.toUtf8().constData()) < 0)
+    const int messageId = spd_say(speechDispatcher, SPD_MESSAGE, text.toUtf8().constData());
+    if (messageId < 0) {
         setError(QTextToSpeech::ErrorReason::Input,
                  QCoreApplication::translate("QTextToSpeech", "Text synthesizing failure."));
+        return;
+    }
+    setCurrentMessage(messageId);
+}
+
+// Routes the events of the message to this engine, including those that
+// arrived while spd_say() was waiting for the reply.
+void QTextToSpeechEngineSpeechd::setCurrentMessage(size_t messageId)
+{
+    m_currentMessage = messageId;
+    QList<SPDNotificationType> events;
+    {
+        QMutexLocker locker(&messages->mutex);
+        messages->lastMessage = qMax(messages->lastMessage, messageId);
+        events = messages->unclaimed.take(messageId);
+        const bool finished = !events.isEmpty() && (events.last() == SPD_EVENT_END
+                                                    || events.last() == SPD_EVENT_CANCEL);
+        if (!finished)
+            messages->owners.insert(messageId, this);
+    }
+
+    // we are on the engine's thread already; signals are emitted after unlocking,
+    // as receivers might call say() again
+    QTextToSpeech::State state = m_state;
+    bool started = false;
+    for (SPDNotificationType type : std::as_const(events))
+        processEvent({messageId, type}, state, started);
+    updateState(state, started);
 }
 
 void QTextToSpeechEngineSpeechd::synthesize(const QString &)
@@ -166,8 +302,8 @@ void QTextToSpeechEngineSpeechd::stop(QTextToSpeech::BoundaryHint boundaryHint)
         return;
 
     if (m_state == QTextToSpeech::Paused)
-        spd_resume_all(speechDispatcher);
-    spd_cancel_all(speechDispatcher);
+        spd_resume(speechDispatcher);
+    spd_cancel(speechDispatcher);
 }
 
 void QTextToSpeechEngineSpeechd::pause(QTextToSpeech::BoundaryHint boundaryHint)
@@ -177,7 +313,7 @@ void QTextToSpeechEngineSpeechd::pause(QTextToSpeech::BoundaryHint boundaryHint)
         return;
 
     if (m_state == QTextToSpeech::Speaking) {
-        spd_pause_all(speechDispatcher);
+        spd_pause(speechDispatcher);
     }
 }
 
@@ -187,7 +323,7 @@ void QTextToSpeechEngineSpeechd::resume()
         return;
 
     if (m_state == QTextToSpeech::Paused) {
-        spd_resume_all(speechDispatcher);
+        spd_resume(speechDispatcher);
     }
 }
 
@@ -267,9 +403,8 @@ bool QTextToSpeechEngineSpeechd::setLocale(const QLocale &locale)
     if (result == 0) {
         const QVoice previousVoice = m_currentVoice;
 
-        const QList<QVoice> voices = m_voices.values(locale);
-        // QMultiHash returns the values in the reverse order
-        if (voices.size() > 0 && setVoice(voices.last()))
+        const QVoice voice = firstVoiceForLocale(locale);
+        if (voice != QVoice() && setVoice(voice))
             return true;
 
         // try to go back to the previous locale/voice
@@ -330,67 +465,167 @@ QString QTextToSpeechEngineSpeechd::errorString() const
     return m_errorString;
 }
 
+// Lists the output modules; their voices are enumerated by loadNextModule().
 void QTextToSpeechEngineSpeechd::updateVoices()
 {
+    m_voices.clear();
+    m_pendingModules.clear();
     char **modules = spd_list_modules(speechDispatcher);
-#ifdef HAVE_SPD_090
-    char *original_module = spd_get_output_module(speechDispatcher);
-#else
-    char *original_module = modules[0];
-#endif
     char **module = modules;
     while (module != nullptr && module[0] != nullptr) {
-        spd_set_output_module(speechDispatcher, module[0]);
-
-        SPDVoice **voices = spd_list_synthesis_voices(speechDispatcher);
-        int i = 0;
-        while (voices != nullptr && voices[i] != nullptr) {
-            const QLocale locale = localeForVoice(voices[i]);
-            const QVariant data = QVariant::fromValue<QByteArray>(module[0]);
-            // speechd declares enums and APIs for gender and age, but the SPDVoice struct
-            // carries no relevant information.
-            const QVoice voice = createVoice(QString::fromUtf8(voices[i]->name), locale,
-                                             QVoice::Unknown, QVoice::Other, data);
-            m_voices.insert(locale, voice);
-            ++i;
-        }
-        // free voices.
-#ifdef HAVE_SPD_090
-        free_spd_voices(voices);
-#endif
+        m_pendingModules.append(QByteArray(module[0]));
         ++module;
     }
-
 #ifdef HAVE_SPD_090
     // Also free modules.
     free_spd_modules(modules);
+
+    char *default_module = spd_get_output_module(speechDispatcher);
+    m_defaultModule = QByteArray(default_module);
+    free(default_module);
+#else
+    m_defaultModule = m_pendingModules.value(0);
 #endif
-    // Set the output module back to what it was.
-    spd_set_output_module(speechDispatcher, original_module);
+    {
+        // modules were installed or removed since the voices were cached
+        QMutexLocker locker(&voiceCache->mutex);
+        if (voiceCache->modules != m_pendingModules) {
+            voiceCache->modules = m_pendingModules;
+            voiceCache->voices.clear();
+        }
+    }
+    // The default module most likely has a voice for the default locale
+    if (const qsizetype index = m_pendingModules.indexOf(m_defaultModule); index > 0)
+        m_pendingModules.move(index, 0);
+    emit voicesChanged();
+}
+
+/*
+    Returns the voices of the output module. Listing them requires switching to the
+    module, so the result is cached until the list of modules changes.
+*/
+QList<QVoice> QTextToSpeechEngineSpeechd::moduleVoices(const QByteArray &module) const
+{
+    {
+        QMutexLocker locker(&voiceCache->mutex);
+        const auto it = voiceCache->voices.constFind(module);
+        if (it != voiceCache->voices.cend())
+            return *it;
+    }
+
+    const QByteArray currentModule = m_currentVoice == QVoice()
+                                   ? m_defaultModule
+                                   : voiceData(m_currentVoice).value<QByteArray>();
+    if (module != currentModule)
+        spd_set_output_module(speechDispatcher, module.constData());
+
+    QList<QVoice> result;
+    const QVariant data = QVariant::fromValue<QByteArray>(module);
+    SPDVoice **voices = spd_list_synthesis_voices(speechDispatcher);
+    int i = 0;
+    while (voices != nullptr && voices[i] != nullptr) {
+        // speechd declares enums and APIs for gender and age, but the SPDVoice struct
+        // carries no relevant information.
+        result.append(createVoice(QString::fromUtf8(voices[i]->name), localeForVoice(voices[i]),
+                                  QVoice::Unknown, QVoice::Other, data));
+        ++i;
+    }
+    // free voices.
 #ifdef HAVE_SPD_090
-    free(original_module);
+    free_spd_voices(voices);
 #endif
+
+    // Set the output module, and the voice, back to what it was.
+    if (module != currentModule) {
+        spd_set_output_module(speechDispatcher, currentModule.constData());
+        if (m_currentVoice != QVoice())
+            spd_set_synthesis_voice(speechDispatcher, m_currentVoice.name().toUtf8().constData());
+    }
+
+    QMutexLocker locker(&voiceCache->mutex);
+    voiceCache->voices.insert(module, result);
+    return result;
+}
+
+bool QTextToSpeechEngineSpeechd::loadNextModule() const
+{
+    if (m_pendingModules.isEmpty())
+        return false;
+
+    const QList<QVoice> voices = moduleVoices(m_pendingModules.takeFirst());
+    for (const QVoice &voice : voices)
+        m_voices.insert(voice.locale(), voice);
+    return true;
+}
+
+void QTextToSpeechEngineSpeechd::loadAllModules() const
+{
+    while (loadNextModule())
+        ;
+}
+
+// Enumerates modules only until one of them has a voice for the locale
+QVoice QTextToSpeechEngineSpeechd::firstVoiceForLocale(const QLocale &locale) const
+{
+    while (!m_voices.contains(locale) && loadNextModule())
+        ;
+    // QMultiHash returns the values in the reverse order, so the first voice of
+    // the first module with the locale is the last value
+    const QList<QVoice> voices = m_voices.values(locale);
+    return voices.isEmpty() ? QVoice() : voices.last();
+}
+
+// Any module can have voices for the locale, so all of them are enumerated
+QList<QVoice> QTextToSpeechEngineSpeechd::voicesForLocale(const QLocale &locale) const
+{
+    loadAllModules();
+    QList<QVoice> resultList = m_voices.values(locale);
+    // QMultiHash returns the values in the reverse order
+    std::reverse(resultList.begin(), resultList.end());
+    return resultList;
 }
 
 QList<QLocale> QTextToSpeechEngineSpeechd::availableLocales() const
 {
+    loadAllModules();
     return m_voices.uniqueKeys();
 }
 
 QList<QVoice> QTextToSpeechEngineSpeechd::availableVoices() const
 {
-    QList<QVoice> resultList = m_voices.values(m_currentVoice.locale());
-    std::reverse(resultList.begin(), resultList.end());
+    return voicesForLocale(m_currentVoice.locale());
+}
+
+QList<QVoice> QTextToSpeechEngineSpeechd::allVoices() const
+{
+    loadAllModules();
+    QList<QVoice> resultList;
+    resultList.reserve(m_voices.size());
+    const QList<QLocale> locales = m_voices.uniqueKeys();
+    for (const QLocale &locale : locales)
+        resultList << voicesForLocale(locale);
     return resultList;
 }
 
 // We have no way of knowing our own client_id since speech-dispatcher seems to be incomplete
-// (history functions are just stubs)
+// (history functions are just stubs), so the events are routed by the id of the message.
 void speech_finished_callback(size_t msg_id, size_t client_id, SPDNotificationType state)
 {
     qCDebug(lcSpeechTtsSpeechd) << "Message from speech dispatcher" << msg_id << client_id;
-    for (QTextToSpeechEngineSpeechd *backend : std::as_const(*backends))
-        backend->spdStateChanged(state);
+    QMutexLocker locker(&messages->mutex);
+    const auto it = messages->owners.constFind(msg_id);
+    if (it == messages->owners.cend()) {
+        // the message of an engine that is still waiting for spd_say() to return;
+        // events of older messages belong to engines that don't exist anymore
+        if (msg_id > messages->lastMessage)
+            messages->unclaimed[msg_id].append(state);
+        return;
+    }
+
+    QTextToSpeechEngineSpeechd *engine = *it;
+    if (state == SPD_EVENT_END || state == SPD_EVENT_CANCEL)
+        messages->owners.erase(it);
+    engine->postEvent(msg_id, state);
 }
 
 QT_END_NAMESPACE
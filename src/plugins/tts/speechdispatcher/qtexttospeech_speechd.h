@@ -7,15 +7,51 @@
 #include "qtexttospeechengine.h"
 #include "qvoice.h"
 
+#include <QtCore/qbytearray.h>
 #include <QtCore/qhash.h>
 #include <QtCore/qlist.h>
 #include <QtCore/qlocale.h>
+#include <QtCore/qmutex.h>
 #include <QtCore/qobject.h>
 #include <QtCore/qstring.h>
 #include <libspeechd.h>
 
+#include <array>
+#include <atomic>
+
 QT_BEGIN_NAMESPACE
 
+// Passes the events of speech-dispatcher from the thread of the connection to
+// the thread of the engine. Pushing an event doesn't lock as long as the ring
+// has space; if it's full, events go to a list that is protected by a mutex.
+class QTextToSpeechSpeechdEventQueue
+{
+public:
+    struct Event
+    {
+        size_t messageId;
+        SPDNotificationType type;
+    };
+
+    // only called by the thread of the connection
+    void push(const Event &event);
+    // only called by the thread of the engine
+    bool pop(Event &event);
+
+private:
+    static constexpr size_t Capacity = 64;
+    std::array<Event, Capacity> m_ring;
+    std::atomic<size_t> m_head = 0;
+    std::atomic<size_t> m_tail = 0;
+
+    QMutex m_overflowMutex;
+    QList<Event> m_overflow;
+    std::atomic<bool> m_overflowed = false;
+    // taken from m_overflow by the engine, and older than the events in the ring
+    QList<Event> m_spilled;
+    qsizetype m_spilledIndex = 0;
+};
+
 class QTextToSpeechEngineSpeechd : public QTextToSpeechEngine
 {
     Q_OBJECT
@@ -27,6 +63,7 @@ public:
     // Plug-in API:
     QList<QLocale> availableLocales() const override;
     QList<QVoice> availableVoices() const override;
+    QList<QVoice> allVoices() const override;
     void say(const QString &text) override;
     void synthesize(const QString &text) override;
     void stop(QTextToSpeech::BoundaryHint boundaryHint) override;
@@ -46,12 +83,22 @@ public:
     QTextToSpeech::ErrorReason errorReason() const override;
     QString errorString() const override;
 
-    void spdStateChanged(SPDNotificationType state);
+    void postEvent(size_t messageId, SPDNotificationType type);
 
 private:
     QLocale localeForVoice(SPDVoice *voice) const;
     bool connectToSpeechDispatcher();
+    void setCurrentMessage(size_t messageId);
+    void processEvents();
+    void processEvent(const QTextToSpeechSpeechdEventQueue::Event &event,
+                      QTextToSpeech::State &state, bool &started) const;
+    void updateState(QTextToSpeech::State state, bool started);
     void updateVoices();
+    QList<QVoice> moduleVoices(const QByteArray &module) const;
+    bool loadNextModule() const;
+    void loadAllModules() const;
+    QVoice firstVoiceForLocale(const QLocale &locale) const;
+    QList<QVoice> voicesForLocale(const QLocale &locale) const;
     void setError(QTextToSpeech::ErrorReason reason, const QString &errorString);
 
     QTextToSpeech::State m_state = QTextToSpeech::Error;
@@ -59,8 +106,16 @@ private:
     QString m_errorString;
     SPDConnection *speechDispatcher;
     QVoice m_currentVoice;
-    // Voices mapped by their locale name.
-    QMultiHash<QLocale, QVoice> m_voices;
+    // the message of the last say(); events of earlier messages are ignored
+    size_t m_currentMessage = 0;
+    QTextToSpeechSpeechdEventQueue m_events;
+    std::atomic<bool> m_eventsPosted = false;
+    // The voices of a module are only enumerated when needed, as that requires
+    // switching the output module. Voices mapped by their locale name.
+    mutable QMultiHash<QLocale, QVoice> m_voices;
+    // Modules whose voices are not in m_voices yet, the default module first
+    mutable QList<QByteArray> m_pendingModules;
+    QByteArray m_defaultModule;
 };
 
 QT_END_NAMESPACE
@@ -263,6 +263,24 @@ QList<QVoice> QTextToSpeechEngineWinRT::availableVoices() const
     return voices;
 }
 
+QList<QVoice> QTextToSpeechEngineWinRT::allVoices() const
+{
+    Q_D(const QTextToSpeechEngineWinRT);
+    if (!d->synth)
+        return QList<QVoice>();
+    QHash<QLocale, QList<QVoice>> voicesByLocale;
+    d->forEachVoice([&](const ComPtr<IVoiceInformation> &voiceInfo) {
+        const QVoice voice = d->createVoiceForInformation(voiceInfo);
+        voicesByLocale[voice.locale()].append(voice);
+        return false;
+    });
+    QList<QVoice> voices;
+    const QList<QLocale> locales = availableLocales();
+    for (const QLocale &locale : locales)
+        voices << voicesByLocale.value(locale);
+    return voices;
+}
+
 QLocale QTextToSpeechEngineWinRT::locale() const
 {
     Q_D(const QTextToSpeechEngineWinRT);
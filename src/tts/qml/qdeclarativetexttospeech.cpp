@@ -95,13 +95,22 @@ void QDeclarativeTextToSpeech::selectVoice()
 
 QList<QVoice> QDeclarativeTextToSpeech::findVoices(const QVariantMap &criteria) const
 {
-    const QLocale *plocale = nullptr;
-    // if we limit by locale, then limit the search to the voices for that
-    if (const auto &it = criteria.find(QLatin1String("locale")); it != criteria.end()) {
-        if (it->metaType() == QMetaType::fromType<QLocale>())
-            plocale = static_cast<const QLocale *>(it->constData());
+    // criteria that are indexed limit the search to the voices that match
+    // those criteria; all criteria are checked for each of those voices below
+    VoiceKeys keys;
+    for (const auto &[key, value] : criteria.asKeyValueRange()) {
+        if (key == "locale"_L1 && value.metaType() == QMetaType::fromType<QLocale>())
+            keys.locale = value.toLocale();
+        else if (key == "language"_L1)
+            keys.language = value.toLocale().language();
+        else if (key == "gender"_L1 && value.metaType() == QMetaType::fromType<QVoice::Gender>())
+            keys.gender = value.value<QVoice::Gender>();
+        else if (key == "age"_L1 && value.metaType() == QMetaType::fromType<QVoice::Age>())
+            keys.age = value.value<QVoice::Age>();
+        else if (key == "name"_L1 && value.metaType() == QMetaType::fromType<QString>())
+            keys.name = value.toString();
     }
-    QList<QVoice> voices = allVoices(plocale);
+    QList<QVoice> voices = findVoicesImpl(keys);
 
     voices.removeIf([&criteria](const QVoice &voice){
         const QMetaObject &mo = QVoice::staticMetaObject;
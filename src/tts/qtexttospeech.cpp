@@ -4,20 +4,31 @@
 
 #include "qtexttospeech.h"
 #include "qtexttospeech_p.h"
+#include "qtexttospeechpluginindex_p.h"
+#include "qtexttospeechsharedengine_p.h"
 
 #include <QtCore/qcborarray.h>
 #include <QtCore/qdebug.h>
-#include <QtCore/private/qfactoryloader_p.h>
 
 #include <QtMultimedia/qaudiobuffer.h>
+#include <QtMultimedia/qaudiodevice.h>
 
 QT_BEGIN_NAMESPACE
 
 using namespace Qt::StringLiterals;
 
-Q_GLOBAL_STATIC_WITH_ARGS(QFactoryLoader, loader,
-        ("org.qt-project.qt.speech.tts.plugin/6.0",
-         QLatin1String("/texttospeech")))
+namespace {
+// The discovered plugins, and their meta data by provider name. Access
+// requires QTextToSpeechPrivate::m_mutex to be locked.
+struct PluginRegistry
+{
+    QTextToSpeechPluginIndex index;
+    QMultiHash<QString, QCborMap> metaData;
+    QStringList providers;
+    bool discovered = false;
+};
+Q_GLOBAL_STATIC(PluginRegistry, pluginRegistry)
+}
 
 QMutex QTextToSpeechPrivate::m_mutex;
 
@@ -37,7 +48,9 @@ void QTextToSpeechPrivate::setEngineProvider(const QString &engine, const QVaria
     Q_Q(QTextToSpeech);
 
     q->stop(QTextToSpeech::BoundaryHint::Immediate);
+    cancelEngineInitialization();
     m_engine.reset();
+    resetVoiceCatalog();
 
     m_providerName = engine;
     if (m_providerName.isEmpty()) {
@@ -60,9 +73,32 @@ void QTextToSpeechPrivate::setEngineProvider(const QString &engine, const QVaria
         return;
     }
     loadPlugin();
+    if (const auto it = params.find("audioDevice"_L1); it != params.end())
+        m_audioDevice = (*it).value<QAudioDevice>();
+    else
+        m_audioDevice = QAudioDevice();
+    if (m_cachePlayer)
+        m_cachePlayer->setAudioDevice(m_audioDevice);
+
     if (m_plugin) {
+        const bool shared = params.value("sharedEngine"_L1).toBool();
+        if (!shared && params.value("initializeAsynchronously"_L1).toBool()
+            && m_metaData.value("AsynchronousInitialization"_L1).toBool()) {
+            startEngineInitialization(params);
+            return;
+        }
+        // Engines can rely on the parameter to know that they get constructed
+        // on a worker thread, and moved to their thread afterwards
+        QVariantMap engineParams = params;
+        engineParams.remove("initializeAsynchronously"_L1);
         QString errorString;
-        m_engine.reset(m_plugin->createTextToSpeechEngine(params, nullptr, &errorString));
+        if (shared) {
+            m_engine.reset(QTextToSpeechSharedEngine::createClient(m_plugin, m_providerName,
+                                                                   engineParams, &errorString));
+        } else {
+            m_engine.reset(m_plugin->createTextToSpeechEngine(engineParams, nullptr,
+                                                              &errorString));
+        }
         if (!m_engine) {
             qCritical() << "Error creating text-to-speech engine" << m_providerName
                         << (errorString.isEmpty() ? QStringLiteral("") : (QStringLiteral(": ") + errorString));
@@ -71,24 +107,142 @@ void QTextToSpeechPrivate::setEngineProvider(const QString &engine, const QVaria
         qCritical() << "Error loading text-to-speech plug-in" << m_providerName;
     }
 
+    setupEngine();
+}
+
+/*
+    Constructs the engine on a worker thread, and moves it to the thread of the
+    QTextToSpeech object. Until engineInitialized() takes the engine over, the
+    state is Initializing, and texts passed to say() or enqueue() get queued.
+    Only plugins with AsynchronousInitialization in their metadata get here;
+    they must create threads, timers, and audio objects only once the engine
+    runs in its thread, e.g. from a call that they queue in the constructor.
+*/
+void QTextToSpeechPrivate::startEngineInitialization(const QVariantMap &params)
+{
+    Q_Q(QTextToSpeech);
+    const quint64 generation = ++m_initGeneration;
+    m_initThread.reset(QThread::create([this, q, plugin = m_plugin, params, generation,
+                                        targetThread = q->thread()]{
+        QString errorString;
+        std::unique_ptr<QTextToSpeechEngine> engine(
+                plugin->createTextToSpeechEngine(params, nullptr, &errorString));
+        if (engine)
+            engine->moveToThread(targetThread);
+        m_initEngine = std::move(engine);
+        m_initErrorString = errorString;
+        QMetaObject::invokeMethod(q, [this, generation]{
+            engineInitialized(generation);
+        }, Qt::QueuedConnection);
+    }));
+    m_initThread->setObjectName(u"QTextToSpeech engine initialization"_s);
+    m_initThread->start();
+    updateState(QTextToSpeech::Initializing);
+}
+
+void QTextToSpeechPrivate::cancelEngineInitialization()
+{
+    if (!m_initThread)
+        return;
+    m_initThread->wait();
+    m_initThread.reset();
+    m_initEngine.reset();
+    m_initErrorString.clear();
+}
+
+void QTextToSpeechPrivate::engineInitialized(quint64 generation)
+{
+    Q_Q(QTextToSpeech);
+    // the initialization got cancelled, or a newer one was started
+    if (!m_initThread || generation != m_initGeneration)
+        return;
+
+    m_initThread->wait();
+    m_initThread.reset();
+    m_engine = std::move(m_initEngine);
+    if (!m_engine) {
+        qCritical() << "Error creating text-to-speech engine" << m_providerName
+                    << (m_initErrorString.isEmpty() ? QStringLiteral("")
+                                                    : (QStringLiteral(": ") + m_initErrorString));
+    }
+    m_initErrorString.clear();
+
+    setupEngine();
+    if (!m_engine) {
+        m_pendingUtterances = {};
+        m_utteranceCounter = 0;
+        emit q->engineChanged(m_providerName);
+        updateState(QTextToSpeech::Error);
+        return;
+    }
+    restoreEngineSettings();
+
+    // speak the texts passed to say() or enqueue() while initializing
+    if (m_pendingUtterances.isEmpty())
+        return;
+    if (m_state != QTextToSpeech::Ready) {
+        m_pendingUtterances = {};
+        m_utteranceCounter = 0;
+        return;
+    }
+    const QString text = m_pendingUtterances.dequeue();
+    prepareUpcomingTexts();
+    emit q->aboutToSynthesize(0);
+    sayText(text);
+}
+
+void QTextToSpeechPrivate::setupEngine()
+{
+    Q_Q(QTextToSpeech);
     if (m_engine) {
         // We have to maintain the public state separately from the engine's actual
         // state, as we use it to manage queued texts
         updateState(m_engine->state());
         QObjectPrivate::connect(m_engine.get(), &QTextToSpeechEngine::stateChanged,
-                                this, &QTextToSpeechPrivate::updateState);
-        // The other engine signals are directly forwarded to public API signals
+                                this, &QTextToSpeechPrivate::engineStateChanged);
+        // The other engine signals are forwarded to public API signals, unless
+        // the output of the engine gets recorded into the cache.
         QObject::connect(m_engine.get(), &QTextToSpeechEngine::errorOccurred,
                          q, &QTextToSpeech::errorOccurred);
-        QObject::connect(m_engine.get(), &QTextToSpeechEngine::sayingWord,
-                         q, [this, q](const QString &word, qsizetype start, qsizetype length){
-            emit q->sayingWord(word, m_currentUtterance, start, length);
-        });
+        QObjectPrivate::connect(m_engine.get(), &QTextToSpeechEngine::sayingWord,
+                                this, &QTextToSpeechPrivate::engineSayingWord);
+        QObjectPrivate::connect(m_engine.get(), &QTextToSpeechEngine::synthesized,
+                                this, &QTextToSpeechPrivate::engineSynthesized);
+        QObjectPrivate::connect(m_engine.get(), &QTextToSpeechEngine::utteranceSynthesized,
+                                this, &QTextToSpeechPrivate::engineUtteranceSynthesized);
+        QObjectPrivate::connect(m_engine.get(), &QTextToSpeechEngine::audioWritten,
+                                this, &QTextToSpeechPrivate::engineAudioWritten);
+        QObjectPrivate::connect(m_engine.get(), &QTextToSpeechEngine::voicesChanged,
+                                this, &QTextToSpeechPrivate::resetVoiceCatalog);
     } else {
         m_providerName.clear();
     }
 }
 
+// Restore values from the previous engine, or from
+// property setters before the engine was initialized.
+void QTextToSpeechPrivate::restoreEngineSettings()
+{
+    Q_Q(QTextToSpeech);
+    if (!qIsNaN(m_storedPitch))
+        m_engine->setPitch(m_storedPitch);
+    if (!qIsNaN(m_storedRate))
+        m_engine->setRate(m_storedRate);
+    if (!qIsNaN(m_storedVolume))
+        m_engine->setVolume(m_storedVolume);
+
+    // setting the engine might have changed these values
+    if (double realPitch = q->pitch(); m_storedPitch != realPitch)
+        emit q->pitchChanged(realPitch);
+    if (double realRate = q->rate(); m_storedRate != realRate)
+        emit q->rateChanged(realRate);
+    if (double realVolume = q->volume(); m_storedVolume != realVolume)
+        emit q->volumeChanged(realVolume);
+
+    emit q->localeChanged(q->locale());
+    emit q->voiceChanged(q->voice());
+}
+
 bool QTextToSpeechPrivate::loadMeta()
 {
     m_plugin = nullptr;
@@ -122,43 +276,60 @@ void QTextToSpeechPrivate::loadPlugin()
         m_plugin = nullptr;
         return;
     }
-    m_plugin = qobject_cast<QTextToSpeechPlugin *>(loader()->instance(idx));
+    QMutexLocker lock(&m_mutex);
+    m_plugin = pluginRegistry->index.instance(idx);
 }
 
 QMultiHash<QString, QCborMap> QTextToSpeechPrivate::plugins(bool reload)
 {
-    static QMultiHash<QString, QCborMap> plugins;
-    static bool alreadyDiscovered = false;
     QMutexLocker lock(&m_mutex);
+    discoverPlugins(reload);
+    return pluginRegistry->metaData;
+}
 
-    if (reload == true)
-        alreadyDiscovered = false;
-
-    if (!alreadyDiscovered) {
-        loadPluginMetadata(plugins);
-        alreadyDiscovered = true;
-    }
-    return plugins;
+QStringList QTextToSpeechPrivate::providers()
+{
+    QMutexLocker lock(&m_mutex);
+    discoverPlugins(false);
+    return pluginRegistry->providers;
 }
 
-void QTextToSpeechPrivate::loadPluginMetadata(QMultiHash<QString, QCborMap> &list)
+// Only reads the meta data of the plugins; a plugin's library gets loaded
+// when an engine of that plugin is created.
+void QTextToSpeechPrivate::discoverPlugins(bool reload)
 {
-    QFactoryLoader *l = loader();
-    QList<QPluginParsedMetaData> meta = l->metaData();
-    for (int i = 0; i < meta.size(); ++i) {
-        QCborMap obj = meta.at(i).value(QtPluginMetaDataKeys::MetaData).toMap();
+    PluginRegistry *registry = pluginRegistry();
+    if (registry->discovered && !reload)
+        return;
+
+    registry->index.load();
+    registry->metaData.clear();
+    const auto &plugins = registry->index.plugins();
+    for (qsizetype i = 0; i < plugins.size(); ++i) {
+        QCborMap obj = plugins.at(i).metaData;
         obj.insert(QLatin1String("index"), i);
-        list.insert(obj.value(QLatin1String("Provider")).toString(), obj);
+        registry->metaData.insert(obj.value(QLatin1String("Provider")).toString(), obj);
     }
+    registry->providers = registry->metaData.keys();
+    registry->discovered = true;
 }
 
 void QTextToSpeechPrivate::updateState(QTextToSpeech::State newState)
 {
     Q_Q(QTextToSpeech);
+    if (m_statisticsTimer.isValid()) {
+        if (newState == QTextToSpeech::Speaking && m_statistics.d->speakingTime < 0)
+            m_statistics.d->speakingTime = m_statisticsTimer.nsecsElapsed() / 1000;
+        else if (newState == QTextToSpeech::Ready || newState == QTextToSpeech::Error)
+            finishStatistics();
+    }
     if (m_state == newState)
         return;
 
     if (newState == QTextToSpeech::Ready) {
+        // A text of a batch that gets synthesized through the queue is done
+        if (m_batchMode == BatchMode::Queue && m_state == QTextToSpeech::Synthesizing)
+            emit q->utteranceSynthesized(m_currentUtterance);
         // If we have more text to process, start the next request immediately,
         // and ignore the transition to Ready (don't emit the signals).
         if (!m_pendingUtterances.isEmpty()) {
@@ -171,14 +342,14 @@ void QTextToSpeechPrivate::updateState(QTextToSpeech::State newState)
                 const auto nextFunction = [this]{
                     switch (m_state) {
                     case QTextToSpeech::Synthesizing:
-                        return &QTextToSpeechEngine::synthesize;
+                        return &QTextToSpeechPrivate::synthesizeText;
                     case QTextToSpeech::Speaking:
                     case QTextToSpeech::Paused:
-                        return &QTextToSpeechEngine::say;
+                        return &QTextToSpeechPrivate::sayText;
                     default:
                         break;
                     }
-                    return decltype(&QTextToSpeechEngine::synthesize)(nullptr);
+                    return decltype(&QTextToSpeechPrivate::synthesizeText)(nullptr);
                 }();
                 if (nextFunction) {
                     const auto oldState = m_state;
@@ -188,7 +359,8 @@ void QTextToSpeechPrivate::updateState(QTextToSpeech::State newState)
                     if (m_state == oldState && !m_pendingUtterances.isEmpty()) {
                         m_pendingUtterances.dequeue();
                         ++m_currentUtterance;
-                        (m_engine.get()->*nextFunction)(nextText);
+                        (this->*nextFunction)(nextText);
+                        prepareUpcomingTexts();
                         return;
                     } else if (m_state == QTextToSpeech::Paused) {
                         // In case of pause(), empty strings got inserted.
@@ -208,16 +380,416 @@ void QTextToSpeechPrivate::updateState(QTextToSpeech::State newState)
         }
     }
     m_state = newState;
+    if (m_state == QTextToSpeech::Ready || m_state == QTextToSpeech::Error)
+        finishFileWriter();
     emit q->stateChanged(newState);
 }
 
 void QTextToSpeechPrivate::disconnectSynthesizeFunctor()
 {
+    m_batchMode = BatchMode::None;
     if (m_slotObject) {
         m_slotObject->destroyIfLastRef();
         m_slotObject = nullptr;
         m_engine->disconnect(m_synthesizeConnection);
+        if (m_cachePlayer)
+            m_cachePlayer->disconnect(m_cacheSynthesizeConnection);
+    }
+}
+
+/*
+    The functions below dispatch requests either to the engine, or - if the
+    cache is enabled and contains the result - to the cache player. On a cache
+    miss, the output of the engine gets recorded, and inserted into the cache
+    once the engine is done. To populate the cache from say(), the text is
+    synthesized, and the cache player plays the data while it is recorded.
+*/
+void QTextToSpeechPrivate::sayText(const QString &text)
+{
+    startStatistics();
+    if (!m_cache.isEnabled()) {
+        m_engine->say(text);
+        return;
+    }
+
+    cancelRecording();
+    const QByteArray key = cacheKey(text);
+    if (const auto entry = m_cache.find(key)) {
+        cachePlayer()->say(*entry, m_engine->volume());
+        // the engine might still be busy with a previous text
+        if (const auto state = m_engine->state();
+            state != QTextToSpeech::Ready && state != QTextToSpeech::Error) {
+            m_engine->stop(QTextToSpeech::BoundaryHint::Immediate);
+        }
+        return;
+    }
+
+    if (m_cachePlayer)
+        m_cachePlayer->abort();
+    if (m_engine->capabilities() & QTextToSpeech::Capability::Synthesize) {
+        startRecording(key, text, true);
+        cachePlayer()->startStream(m_engine->volume());
+        m_engine->synthesize(text);
+    } else {
+        m_engine->say(text);
+    }
+}
+
+void QTextToSpeechPrivate::synthesizeText(const QString &text)
+{
+    startStatistics();
+    m_synthesizedTime = 0;
+    if (!m_cache.isEnabled()) {
+        m_engine->synthesize(text);
+        return;
+    }
+
+    cancelRecording();
+    const QByteArray key = cacheKey(text);
+    if (const auto entry = m_cache.find(key)) {
+        cachePlayer()->synthesize(*entry);
+        return;
+    }
+
+    if (m_cachePlayer)
+        m_cachePlayer->abort();
+    startRecording(key, text, false);
+    m_engine->synthesize(text);
+}
+
+// Let the engine prepare the texts that will be spoken after the current one
+void QTextToSpeechPrivate::prepareUpcomingTexts()
+{
+    QStringList texts;
+    // with the cache, texts are not spoken through the engine's say()
+    if (!m_cache.isEnabled()
+        && (m_state == QTextToSpeech::Speaking || m_state == QTextToSpeech::Paused)) {
+        for (const QString &text : std::as_const(m_pendingUtterances)) {
+            if (texts.size() == MaxPreparedTexts)
+                break;
+            if (!text.isEmpty())
+                texts.append(text);
+        }
+    }
+    if (texts == m_preparedTexts)
+        return;
+    m_preparedTexts = texts;
+    m_engine->prepare(m_preparedTexts);
+}
+
+QTextToSpeech::State QTextToSpeechPrivate::engineState() const
+{
+    if (m_cachePlayer && m_cachePlayer->state() != QTextToSpeech::Ready)
+        return m_cachePlayer->state();
+    const QTextToSpeech::State state = m_engine->state();
+    // synthesizing a text for say() is reported as speaking
+    if (state == QTextToSpeech::Synthesizing && !m_recordingKey.isEmpty() && m_recordingForSay)
+        return QTextToSpeech::Speaking;
+    return state;
+}
+
+void QTextToSpeechPrivate::engineStateChanged(QTextToSpeech::State newState)
+{
+    // the cache player plays what the engine synthesizes for say()
+    if (!m_recordingKey.isEmpty() && m_recordingForSay) {
+        switch (newState) {
+        case QTextToSpeech::Ready: {
+            const QString text = std::exchange(m_recordingText, {});
+            const QTextToSpeechCache::Entry entry = std::exchange(m_recording, {});
+            const QByteArray key = std::exchange(m_recordingKey, {});
+            if (entry.data.isEmpty()) {
+                m_cachePlayer->abort();
+                m_engine->say(text);
+                return;
+            }
+            if (m_recordingValid)
+                m_cache.insert(key, entry);
+            // the player becomes Ready once it has played all data
+            m_cachePlayer->finishStream();
+            return;
+        }
+        case QTextToSpeech::Error:
+            cancelRecording();
+            m_cachePlayer->abort();
+            break;
+        default:
+            // the player reports the state once it plays the first data
+            if (cachePlayerActive())
+                return;
+            if (newState == QTextToSpeech::Synthesizing)
+                newState = QTextToSpeech::Speaking;
+            break;
+        }
+        updateState(newState);
+        return;
+    }
+
+    // the engine got stopped when we started playing from the cache
+    if (cachePlayerActive())
+        return;
+
+    if (!m_recordingKey.isEmpty()) {
+        switch (newState) {
+        case QTextToSpeech::Ready:
+            if (m_recordingValid && !m_recording.data.isEmpty())
+                m_cache.insert(m_recordingKey, m_recording);
+            cancelRecording();
+            break;
+        case QTextToSpeech::Error:
+            cancelRecording();
+            break;
+        default:
+            break;
+        }
+    }
+    updateState(newState);
+}
+
+void QTextToSpeechPrivate::engineSayingWord(const QString &word, qsizetype start, qsizetype length)
+{
+    Q_Q(QTextToSpeech);
+    if (!m_recordingKey.isEmpty()) {
+        const qint64 time = m_recording.format.durationForBytes(m_recording.data.size());
+        m_recording.words.append({time, word, start, length});
+        // the player reports the words when it plays them
+        if (m_recordingForSay) {
+            m_cachePlayer->appendStreamWord(m_recording.words.constLast());
+            return;
+        }
+    }
+    emit q->sayingWord(word, m_currentUtterance, start, length);
+}
+
+void QTextToSpeechPrivate::engineSynthesized(const QAudioFormat &format, const QByteArray &data)
+{
+    // engines report the data that they play through audioWritten()
+    if (m_engine->state() != QTextToSpeech::Speaking)
+        engineAudioWritten(format, data.size());
+    if (m_recordingKey.isEmpty())
+        return;
+    if (m_recording.data.isEmpty())
+        m_recording.format = format;
+    else if (m_recording.format != format)
+        m_recordingValid = false;
+    m_recording.data += data;
+    if (m_recordingForSay)
+        m_cachePlayer->appendStream(format, data);
+}
+
+void QTextToSpeechPrivate::engineUtteranceSynthesized(qsizetype index)
+{
+    Q_Q(QTextToSpeech);
+    if (m_batchMode != BatchMode::Engine)
+        return;
+    finishStatistics();
+    // the data that the engine emits next belongs to the next text
+    m_currentUtterance = index + 1;
+    if (m_currentUtterance < m_utteranceCounter)
+        startStatistics();
+    emit q->utteranceSynthesized(index);
+}
+
+void QTextToSpeechPrivate::engineAudioWritten(const QAudioFormat &format, qint64 bytes)
+{
+    if (!m_statisticsTimer.isValid())
+        return;
+    QTextToSpeechStatisticsPrivate *statistics = m_statistics.d.data();
+    statistics->synthesisTime = m_statisticsTimer.nsecsElapsed() / 1000;
+    if (statistics->firstAudioTime < 0)
+        statistics->firstAudioTime = statistics->synthesisTime;
+    ++statistics->chunkCount;
+    statistics->byteCount += bytes;
+    if (format.isValid())
+        statistics->audioDuration += bytes / format.bytesPerFrame() * 1000000 / format.sampleRate();
+}
+
+void QTextToSpeechPrivate::startStatistics()
+{
+    finishStatistics();
+    m_statistics.d->id = m_currentUtterance;
+    m_statisticsTimer.start();
+}
+
+void QTextToSpeechPrivate::finishStatistics()
+{
+    Q_Q(QTextToSpeech);
+    if (!m_statisticsTimer.isValid())
+        return;
+    m_statistics.d->totalTime = m_statisticsTimer.nsecsElapsed() / 1000;
+    m_statisticsTimer.invalidate();
+    const QTextToSpeechStatistics statistics = std::exchange(m_statistics, {});
+    emit q->statisticsAvailable(statistics);
+}
+
+/*
+    Reads the catalog of voices from the engine if necessary, and indexes it by
+    the voice properties. Returns false if the engine doesn't provide a catalog.
+*/
+bool QTextToSpeechPrivate::ensureVoiceCatalog() const
+{
+    if (!m_voiceCatalogValid) {
+        m_voiceCatalog = m_engine->allVoices();
+        for (qsizetype i = 0; i < m_voiceCatalog.size(); ++i) {
+            const QVoice &voice = m_voiceCatalog.at(i);
+            const QLocale locale = voice.locale();
+            m_voicesByLocale[locale].append(i);
+            m_voicesByLanguage[locale.language()].append(i);
+            m_voicesByTerritory[locale.territory()].append(i);
+            m_voicesByGender[voice.gender()].append(i);
+            m_voicesByAge[voice.age()].append(i);
+            m_voicesByName[voice.name()].append(i);
+        }
+        m_voiceCatalogValid = true;
+    }
+    return !m_voiceCatalog.isEmpty();
+}
+
+void QTextToSpeechPrivate::resetVoiceCatalog()
+{
+    m_voiceCatalogValid = false;
+    m_voiceCatalog.clear();
+    m_voicesByLocale.clear();
+    m_voicesByLanguage.clear();
+    m_voicesByTerritory.clear();
+    m_voicesByGender.clear();
+    m_voicesByAge.clear();
+    m_voicesByName.clear();
+}
+
+/*
+    Returns the voices from the catalog that match all \a keys. The smallest
+    of the index buckets for the keys is checked against the other keys, so
+    the cost depends on the size of that bucket, not on the number of voices.
+*/
+QList<QVoice> QTextToSpeechPrivate::lookupVoices(const QTextToSpeech::VoiceKeys &keys) const
+{
+    const QList<qsizetype> *candidates = nullptr;
+    const auto narrow = [&candidates](const auto &index, const auto &key) {
+        if (!key)
+            return true;
+        const auto it = index.constFind(*key);
+        if (it == index.cend())
+            return false;
+        if (!candidates || it->size() < candidates->size())
+            candidates = &*it;
+        return true;
+    };
+    if (!narrow(m_voicesByLocale, keys.locale)
+        || !narrow(m_voicesByLanguage, keys.language)
+        || !narrow(m_voicesByTerritory, keys.territory)
+        || !narrow(m_voicesByGender, keys.gender)
+        || !narrow(m_voicesByAge, keys.age)
+        || !narrow(m_voicesByName, keys.name)) {
+        return {};
+    }
+    if (!candidates)
+        return m_voiceCatalog;
+
+    QList<QVoice> voices;
+    for (qsizetype index : *candidates) {
+        const QVoice &voice = m_voiceCatalog.at(index);
+        const QLocale locale = voice.locale();
+        if ((!keys.locale || locale == *keys.locale)
+            && (!keys.language || locale.language() == *keys.language)
+            && (!keys.territory || locale.territory() == *keys.territory)
+            && (!keys.gender || voice.gender() == *keys.gender)
+            && (!keys.age || voice.age() == *keys.age)
+            && (!keys.name || voice.name() == *keys.name)) {
+            voices << voice;
+        }
+    }
+    return voices;
+}
+
+bool QTextToSpeechPrivate::startFileWriter(const QString &text,
+                                           std::unique_ptr<QTextToSpeechFileWriter> &&writer)
+{
+    Q_Q(QTextToSpeech);
+    if (!(m_engine->capabilities() & QTextToSpeech::Capability::Synthesize)) {
+        qWarning("QTextToSpeech::synthesizeToFile: engine doesn't support synthesizing");
+        return false;
+    }
+    if (!writer->open())
+        return false;
+
+    q->stop(QTextToSpeech::BoundaryHint::Immediate);
+    finishFileWriter();
+
+    m_fileWriter = std::move(writer);
+    QTextToSpeechFileWriter *fileWriter = m_fileWriter.get();
+    m_fileWriterConnection = QObject::connect(q, &QTextToSpeech::sayingWord,
+                                              q, [fileWriter](const QString &word){
+        fileWriter->addCuePoint(word);
+    });
+    q->synthesize(text, q, [fileWriter](const QAudioFormat &format, const QByteArray &bytes){
+        fileWriter->write(format, bytes);
+    });
+    return true;
+}
+
+void QTextToSpeechPrivate::finishFileWriter()
+{
+    if (!m_fileWriter)
+        return;
+    QObject::disconnect(m_fileWriterConnection);
+    // the functor writes into the file
+    disconnectSynthesizeFunctor();
+    m_fileWriter.reset();
+}
+
+QTextToSpeechCachePlayer *QTextToSpeechPrivate::cachePlayer()
+{
+    Q_Q(QTextToSpeech);
+    if (!m_cachePlayer) {
+        m_cachePlayer = std::make_unique<QTextToSpeechCachePlayer>();
+        m_cachePlayer->setAudioDevice(m_audioDevice);
+        QObjectPrivate::connect(m_cachePlayer.get(), &QTextToSpeechCachePlayer::stateChanged,
+                                this, &QTextToSpeechPrivate::updateState);
+        QObject::connect(m_cachePlayer.get(), &QTextToSpeechCachePlayer::errorOccurred,
+                         q, &QTextToSpeech::errorOccurred);
+        QObject::connect(m_cachePlayer.get(), &QTextToSpeechCachePlayer::sayingWord,
+                         q, [this, q](const QString &word, qsizetype start, qsizetype length){
+            emit q->sayingWord(word, m_currentUtterance, start, length);
+        });
+    }
+    return m_cachePlayer.get();
+}
+
+bool QTextToSpeechPrivate::cachePlayerActive() const
+{
+    if (!m_cachePlayer)
+        return false;
+    switch (m_cachePlayer->state()) {
+    case QTextToSpeech::Speaking:
+    case QTextToSpeech::Paused:
+    case QTextToSpeech::Synthesizing:
+        return true;
+    default:
+        break;
     }
+    return false;
+}
+
+QByteArray QTextToSpeechPrivate::cacheKey(const QString &text) const
+{
+    return QTextToSpeechCache::key(m_providerName, m_engine->voice(), m_engine->rate(),
+                                   m_engine->pitch(), m_engine->volume(), text);
+}
+
+void QTextToSpeechPrivate::startRecording(const QByteArray &key, const QString &text, bool forSay)
+{
+    m_recordingKey = key;
+    m_recordingText = text;
+    m_recording = {};
+    m_recordingForSay = forSay;
+    m_recordingValid = true;
+}
+
+void QTextToSpeechPrivate::cancelRecording()
+{
+    m_recordingKey.clear();
+    m_recordingText.clear();
+    m_recording = {};
 }
 
 /*!
@@ -312,6 +884,11 @@ void QTextToSpeechPrivate::disconnectSynthesizeFunctor()
                         signal will be emitted with chunks of data.
     \value Paused       The synthesis was paused and can be resumed with \l resume().
     \value Error        An error has occurred. Details are given by \l errorReason().
+    \value [since 6.9] Initializing
+                        The engine is being initialized in the background. Texts
+                        passed to say() or enqueue() are spoken once the engine
+                        is ready. See \l{Qt TextToSpeech Engines} for how to
+                        initialize an engine asynchronously.
 
     \sa QTextToSpeech::ErrorReason errorReason() errorString()
 */
@@ -426,7 +1003,9 @@ QTextToSpeech::QTextToSpeech(const QString &engine, const QVariantMap &params, Q
 */
 QTextToSpeech::~QTextToSpeech()
 {
+    Q_D(QTextToSpeech);
     stop(QTextToSpeech::BoundaryHint::Immediate);
+    d->cancelEngineInitialization();
 }
 
 /*!
@@ -478,31 +1057,14 @@ bool QTextToSpeech::setEngine(const QString &engine, const QVariantMap &params)
     d->setEngineProvider(engine, params);
 
     emit engineChanged(d->m_providerName);
-    d->updateState(d->m_engine ? d->m_engine->state()
-                               : QTextToSpeech::Error);
+    if (d->m_engine)
+        d->updateState(d->m_engine->state());
+    else if (!d->m_initThread)
+        d->updateState(QTextToSpeech::Error);
 
-    // Restore values from the previous engine, or from
-    // property setters before the engine was initialized.
-    if (d->m_engine) {
-        if (!qIsNaN(d->m_storedPitch))
-            d->m_engine->setPitch(d->m_storedPitch);
-        if (!qIsNaN(d->m_storedRate))
-            d->m_engine->setRate(d->m_storedRate);
-        if (!qIsNaN(d->m_storedVolume))
-            d->m_engine->setVolume(d->m_storedVolume);
-
-        // setting the engine might have changed these values
-        if (double realPitch = pitch(); d->m_storedPitch != realPitch)
-            emit pitchChanged(realPitch);
-        if (double realRate = rate(); d->m_storedRate != realRate)
-            emit rateChanged(realRate);
-        if (double realVolume = volume(); d->m_storedVolume != realVolume)
-            emit volumeChanged(realVolume);
-
-        emit localeChanged(locale());
-        emit voiceChanged(voice());
-    }
-    return d->m_engine.get();
+    if (d->m_engine)
+        d->restoreEngineSettings();
+    return d->m_engine || d->m_initThread;
 }
 
 QString QTextToSpeech::engine() const
@@ -591,7 +1153,7 @@ QTextToSpeech::Capabilities QTextToSpeech::engineCapabilities() const
 */
 QStringList QTextToSpeech::availableEngines()
 {
-    return QTextToSpeechPrivate::plugins().keys();
+    return QTextToSpeechPrivate::providers();
 }
 
 /*!
@@ -710,6 +1272,8 @@ QTextToSpeech::State QTextToSpeech::state() const
 QTextToSpeech::ErrorReason QTextToSpeech::errorReason() const
 {
     Q_D(const QTextToSpeech);
+    if (d->m_cachePlayer && d->m_cachePlayer->state() == QTextToSpeech::Error)
+        return QTextToSpeech::ErrorReason::Playback;
     if (d->m_engine)
         return d->m_engine->errorReason();
     return QTextToSpeech::ErrorReason::Initialization;
@@ -728,6 +1292,8 @@ QTextToSpeech::ErrorReason QTextToSpeech::errorReason() const
 QString QTextToSpeech::errorString() const
 {
     Q_D(const QTextToSpeech);
+    if (d->m_cachePlayer && d->m_cachePlayer->state() == QTextToSpeech::Error)
+        return d->m_cachePlayer->errorString();
     if (d->m_engine)
         return d->m_engine->errorString();
     return tr("Text to speech engine not initialized");
@@ -777,8 +1343,11 @@ void QTextToSpeech::say(const QString &text)
     d->m_pendingUtterances = {};
     d->m_utteranceCounter = 1;
     if (d->m_engine) {
+        d->prepareUpcomingTexts();
         emit aboutToSynthesize(0);
-        d->m_engine->say(text);
+        d->sayText(text);
+    } else if (d->m_state == QTextToSpeech::Initializing) {
+        d->m_pendingUtterances.enqueue(text);
     }
 }
 
@@ -823,20 +1392,28 @@ void QTextToSpeech::say(const QString &text)
 qsizetype QTextToSpeech::enqueue(const QString &utterance)
 {
     Q_D(QTextToSpeech);
-    if (!d->m_engine || utterance.isEmpty())
+    if (utterance.isEmpty())
         return -1;
+    if (!d->m_engine) {
+        if (d->m_state != QTextToSpeech::Initializing)
+            return -1;
+        d->m_pendingUtterances.enqueue(utterance);
+        return d->m_utteranceCounter++;
+    }
 
-    switch (d->m_engine->state()) {
+    switch (d->engineState()) {
     case QTextToSpeech::Error:
         return -1;
     case QTextToSpeech::Ready:
         emit aboutToSynthesize(0);
-        d->m_engine->say(utterance);
+        d->sayText(utterance);
         break;
     case QTextToSpeech::Speaking:
     case QTextToSpeech::Synthesizing:
     case QTextToSpeech::Paused:
+    case QTextToSpeech::Initializing:
         d->m_pendingUtterances.enqueue(utterance);
+        d->prepareUpcomingTexts();
         break;
     }
 
@@ -858,6 +1435,13 @@ qsizetype QTextToSpeech::enqueue(const QString &utterance)
     describing the \l {QAudioFormat}{format} of the data in \c bytes;
     or as \c {functor(QAudioBuffer &buffer)}.
 
+    Since Qt 6.9, the \a functor can also be called as
+    \c {functor(QByteArrayView data, QAudioFormat format, qint64 startTime)},
+    with \c startTime being the time of the first sample in \c data, in
+    microseconds since the start of the utterance. The memory referenced by
+    \c data is only valid until the \a functor returns; engines might reuse
+    it for subsequent chunks of data, avoiding an allocation for each chunk.
+
     The \l state property is set to \l Synthesizing when the synthesis starts,
     and to \l Ready once the synthesis is finished. While synthesizing, the
     \a functor might be called multiple times, possibly with changing values
@@ -911,10 +1495,19 @@ void QTextToSpeech::synthesizeImpl(const QString &text,
     d->m_slotObject = slotObj;
     const auto receive = [d, context, overload](const QAudioFormat &format, const QByteArray &bytes){
         Q_ASSERT(d->m_slotObject);
+        const qint64 startTime = d->m_synthesizedTime;
+        d->m_synthesizedTime += format.durationForBytes(bytes.size());
         if (overload == SynthesizeOverload::AudioBuffer) {
-            const QAudioBuffer buffer(bytes, format);
+            const QAudioBuffer buffer(bytes, format, startTime);
             void *args[] = {nullptr, const_cast<QAudioBuffer *>(&buffer)};
             d->m_slotObject->call(const_cast<QObject *>(context), args);
+        } else if (overload == SynthesizeOverload::ByteArrayView) {
+            QByteArrayView data(bytes);
+            void *args[] = {nullptr,
+                            &data,
+                            const_cast<QAudioFormat *>(&format),
+                            const_cast<qint64 *>(&startTime)};
+            d->m_slotObject->call(const_cast<QObject *>(context), args);
         } else {
             void *args[] = {nullptr,
                             const_cast<QAudioFormat *>(&format),
@@ -928,10 +1521,196 @@ void QTextToSpeech::synthesizeImpl(const QString &text,
     if (!d->m_engine)
         return;
 
-    if (d->m_engine->state() == QTextToSpeech::Synthesizing)
+    if (d->m_cache.isEnabled()) {
+        QObject::disconnect(d->m_cacheSynthesizeConnection);
+        d->m_cacheSynthesizeConnection = connect(d->cachePlayer(),
+                                                 &QTextToSpeechCachePlayer::synthesized,
+                                                 context ? context : this, receive);
+    }
+
+    if (d->engineState() == QTextToSpeech::Synthesizing)
         d->m_pendingUtterances.enqueue(text);
     else
-        d->m_engine->synthesize(text);
+        d->synthesizeText(text);
+}
+
+/*!
+    \fn template<typename Functor> void QTextToSpeech::synthesizeBatch(
+            const QStringList &texts, Functor &&functor)
+    \fn template<typename Functor> void QTextToSpeech::synthesizeBatch(
+            const QStringList &texts, const QObject *context, Functor &&functor)
+    \since 6.9
+
+    Synthesizes all \a texts into raw audio data.
+
+    This function works like synthesize(), but passes all \a texts to the
+    engine at once. Engines that support it can then process the texts without
+    returning to the event loop between texts, or synthesize several texts in
+    parallel.
+
+    When data is available, the \a functor will be called as
+    \c {functor(qsizetype id, QAudioFormat format, QByteArray bytes)}, with
+    \c id being the index of the text in \a texts that the data in \c bytes
+    belongs to. The data is always delivered in the order of \a texts. Once all
+    data for a text has been delivered, the utteranceSynthesized() signal is
+    emitted with the index of that text.
+
+    As with say(), any ongoing speech or synthesis is stopped, and the queue
+    of pending texts is cleared. The \a functor can be a callable with an
+    optional \a context object, or a member function of the \a context object.
+    If \a context is destroyed, then the \a functor will no longer get called.
+
+    \a texts must not contain empty strings.
+
+    \note This API requires that the engine has the
+    \l {QTextToSpeech::Capability::}{Synthesize} capability.
+
+    \sa synthesize(), utteranceSynthesized()
+*/
+
+/*!
+    \fn void QTextToSpeech::utteranceSynthesized(qsizetype id)
+    \since 6.9
+
+    This signal is emitted when all data for the text with index \a id in
+    the list passed to synthesizeBatch() has been delivered.
+
+    \sa synthesizeBatch()
+*/
+
+/*!
+    \fn void QTextToSpeech::statisticsAvailable(const QTextToSpeechStatistics &statistics)
+    \since 6.9
+
+    This signal is emitted when the engine is done with a text, or stopped
+    processing it, with the \a statistics for that text.
+
+    The signal is emitted for texts passed to say(), enqueue(), synthesize(),
+    and synthesizeBatch(). Applications can use it to monitor the latency and
+    throughput of the engine.
+
+    \sa QTextToSpeechStatistics
+*/
+
+/*!
+    \internal
+
+    Handles the data of a batch of \a texts, passing the index of the current
+    text to \a slotObj.
+*/
+void QTextToSpeech::synthesizeBatchImpl(const QStringList &texts,
+                                        QtPrivate::QSlotObjectBase *slotObj,
+                                        const QObject *context)
+{
+    Q_D(QTextToSpeech);
+    Q_ASSERT(slotObj);
+    if (!d->m_engine || texts.isEmpty() || texts.contains(QString())) {
+        if (!texts.isEmpty())
+            qWarning("QTextToSpeech::synthesizeBatch: texts must not contain empty strings");
+        slotObj->destroyIfLastRef();
+        return;
+    }
+
+    stop(QTextToSpeech::BoundaryHint::Immediate);
+    d->m_slotObject = slotObj;
+    d->m_currentUtterance = 0;
+    d->m_utteranceCounter = texts.size();
+
+    const auto receive = [d, context](const QAudioFormat &format, const QByteArray &bytes){
+        Q_ASSERT(d->m_slotObject);
+        qsizetype id = d->m_currentUtterance;
+        void *args[] = {nullptr,
+                        &id,
+                        const_cast<QAudioFormat *>(&format),
+                        const_cast<QByteArray *>(&bytes)};
+        d->m_slotObject->call(const_cast<QObject *>(context), args);
+    };
+    d->m_synthesizeConnection = connect(d->m_engine.get(), &QTextToSpeechEngine::synthesized,
+                                        context ? context : this, receive);
+
+    // The cache has to see each text individually
+    if (!d->m_cache.isEnabled() && d->m_engine->synthesizeBatch(texts)) {
+        d->m_batchMode = QTextToSpeechPrivate::BatchMode::Engine;
+        d->startStatistics();
+        return;
+    }
+
+    if (d->m_cache.isEnabled()) {
+        QObject::disconnect(d->m_cacheSynthesizeConnection);
+        d->m_cacheSynthesizeConnection = connect(d->cachePlayer(),
+                                                 &QTextToSpeechCachePlayer::synthesized,
+                                                 context ? context : this, receive);
+    }
+    d->m_batchMode = QTextToSpeechPrivate::BatchMode::Queue;
+    d->m_pendingUtterances.append(texts.sliced(1));
+    d->synthesizeText(texts.first());
+}
+
+/*!
+    \enum QTextToSpeech::FileFormat
+    \since 6.9
+
+    \brief This enum describes the format in which synthesizeToFile() writes
+    the audio data.
+
+    \value Raw              The raw PCM data, without any header.
+    \value Wav              A WAV file.
+    \value WavWithCuePoints A WAV file with a cue point for each word, and
+                            the words as labels of the cue points.
+*/
+
+/*!
+    \since 6.9
+
+    Synthesizes the \a text into \a device, using \a format.
+
+    This function works like synthesize(), but writes the audio data into
+    \a device as soon as it is available. The data is not collected in memory,
+    so memory use doesn't grow with the length of \a text. Once the \l state
+    changes back to \l Ready, all data has been written to \a device. If
+    \a device is not sequential, then the sizes in the WAV header are updated
+    at that point; otherwise, they are left at the maximum value, and no cue
+    points are written, as nothing can follow the data.
+
+    As with say(), any ongoing speech or synthesis is stopped. The \a device
+    must be open for writing, and must stay valid until the synthesis is done.
+    Returns whether the synthesis could be started; this fails if the engine
+    doesn't have the \l {QTextToSpeech::Capability::}{Synthesize} capability.
+
+    \note The word timeline for \l {FileFormat::}{WavWithCuePoints} requires
+    that the engine reports words while synthesizing.
+
+    \note This API requires that the engine has the
+    \l {QTextToSpeech::Capability::}{Synthesize} capability.
+
+    \sa synthesize()
+*/
+bool QTextToSpeech::synthesizeToFile(const QString &text, QIODevice *device, FileFormat format)
+{
+    Q_D(QTextToSpeech);
+    if (!d->m_engine)
+        return false;
+    return d->startFileWriter(text, std::make_unique<QTextToSpeechFileWriter>(device, format));
+}
+
+/*!
+    \since 6.9
+    \overload
+
+    Synthesizes the \a text into the file \a fileName, using \a format.
+    An existing file is overwritten. The file is closed once the \l state
+    changes back to \l Ready. Returns \c false if the file can't be opened
+    for writing.
+*/
+bool QTextToSpeech::synthesizeToFile(const QString &text, const QString &fileName,
+                                     FileFormat format)
+{
+    Q_D(QTextToSpeech);
+    if (!d->m_engine)
+        return false;
+    return d->startFileWriter(text,
+                              std::make_unique<QTextToSpeechFileWriter>(
+                                  std::make_unique<QFile>(fileName), format));
 }
 
 /*!
@@ -961,8 +1740,12 @@ void QTextToSpeech::stop(BoundaryHint boundaryHint)
     d->m_pendingUtterances = {};
     d->m_utteranceCounter = 0;
     if (d->m_engine) {
+        d->prepareUpcomingTexts();
         if (boundaryHint == QTextToSpeech::BoundaryHint::Immediate)
             d->disconnectSynthesizeFunctor();
+        d->cancelRecording();
+        if (d->m_cachePlayer)
+            d->m_cachePlayer->stop();
         d->m_engine->stop(boundaryHint);
     }
 }
@@ -996,8 +1779,12 @@ void QTextToSpeech::pause(BoundaryHint boundaryHint)
             d->m_pendingUtterances.prepend(QString());
     }
     // pause called in response to aboutToSynthesize
-    if (d->m_engine->state() == QTextToSpeech::Ready) {
+    if (d->engineState() == QTextToSpeech::Ready) {
         d->updateState(QTextToSpeech::Paused);
+    } else if (d->cachePlayerActive()) {
+        // the player can't pause at word or sentence boundaries
+        if (boundaryHint != BoundaryHint::Utterance)
+            d->m_cachePlayer->pause();
     } else {
         d->m_engine->pause(boundaryHint);
     }
@@ -1028,8 +1815,10 @@ void QTextToSpeech::resume()
     if (d->m_engine) {
         // If we are pausing before proceeding with the next utterance,
         // then continue with the next pending text.
-        if (d->m_engine->state() == QTextToSpeech::Ready)
+        if (d->engineState() == QTextToSpeech::Ready)
             d->updateState(QTextToSpeech::Ready);
+        else if (d->cachePlayerActive())
+            d->m_cachePlayer->resume();
         else
             d->m_engine->resume();
     }
@@ -1341,12 +2130,125 @@ QList<QVoice> QTextToSpeech::availableVoices() const
     \sa VoiceSelector
 */
 
+/*!
+    \since 6.9
+
+    Sets the capacity of the in-memory synthesis cache to \a bytes.
+
+    The cache stores the audio data that the engine produces for a text,
+    together with the words reported through sayingWord(). The data is stored
+    for the combination of engine, \l voice, \l rate, \l pitch, \l volume, and
+    text. When a text is spoken or synthesized again with the same combination,
+    then the data is played from the cache, without using the engine.
+
+    The least recently used entries are removed when the audio data of all
+    entries exceeds \a bytes. The default capacity is 0, which disables the
+    in-memory cache.
+
+    \note When the cache is enabled, say() synthesizes texts that are not in the
+    cache yet, and plays the audio data while the engine produces it. This
+    requires that the engine has the
+    \l {QTextToSpeech::Capability::}{Synthesize} capability; otherwise, texts
+    that are spoken are not cached.
+
+    \sa setCacheDirectory(), cacheHits(), clearCache()
+*/
+void QTextToSpeech::setCacheCapacity(qsizetype bytes)
+{
+    Q_D(QTextToSpeech);
+    d->m_cache.setCapacity(qMax(bytes, qsizetype(0)));
+}
+
+/*!
+    \since 6.9
+
+    Returns the capacity of the in-memory synthesis cache, in bytes.
+
+    \sa setCacheCapacity()
+*/
+qsizetype QTextToSpeech::cacheCapacity() const
+{
+    Q_D(const QTextToSpeech);
+    return d->m_cache.capacity();
+}
+
+/*!
+    \since 6.9
+
+    Sets the directory in which the synthesis cache stores entries to \a path.
+
+    Entries in the directory persist between runs of the application, and can
+    be shared by several QTextToSpeech objects. Entries are not removed from the
+    directory automatically. Setting an empty \a path, which is the default,
+    disables the on-disk cache.
+
+    \sa setCacheCapacity(), clearCache()
+*/
+void QTextToSpeech::setCacheDirectory(const QString &path)
+{
+    Q_D(QTextToSpeech);
+    d->m_cache.setDirectory(path);
+}
+
+/*!
+    \since 6.9
+
+    Returns the directory in which the synthesis cache stores entries.
+
+    \sa setCacheDirectory()
+*/
+QString QTextToSpeech::cacheDirectory() const
+{
+    Q_D(const QTextToSpeech);
+    return d->m_cache.directory();
+}
+
+/*!
+    \since 6.9
+
+    Returns the number of texts that were spoken or synthesized from the
+    synthesis cache.
+
+    \sa cacheMisses(), setCacheCapacity()
+*/
+qint64 QTextToSpeech::cacheHits() const
+{
+    Q_D(const QTextToSpeech);
+    return d->m_cache.hits();
+}
+
+/*!
+    \since 6.9
+
+    Returns the number of texts that were not found in the synthesis cache,
+    and that were processed by the engine.
+
+    \sa cacheHits(), setCacheCapacity()
+*/
+qint64 QTextToSpeech::cacheMisses() const
+{
+    Q_D(const QTextToSpeech);
+    return d->m_cache.misses();
+}
+
+/*!
+    \since 6.9
+
+    Removes all entries from the synthesis cache, including the entries in
+    the \l {setCacheDirectory()}{cache directory}.
+*/
+void QTextToSpeech::clearCache()
+{
+    Q_D(QTextToSpeech);
+    d->m_cache.clear();
+}
+
 /*!
     \internal
 
-    Returns the list of all voices. This requires iterating through all locales,
-    unless \a locale is set, in which case we can just go through the voices for
-    that locale.
+    Returns the list of all voices, or only the voices for \a locale if it is
+    set. The voices are looked up in the catalog of the engine. For engines that
+    don't provide a catalog, this requires iterating through all locales.
 */
 QList<QVoice> QTextToSpeech::allVoices(const QLocale *locale) const
 {
@@ -1354,6 +2256,13 @@ QList<QVoice> QTextToSpeech::allVoices(const QLocale *locale) const
     if (!d->m_engine)
         return {};
 
+    if (d->ensureVoiceCatalog()) {
+        VoiceKeys keys;
+        if (locale)
+            keys.locale = *locale;
+        return d->lookupVoices(keys);
+    }
+
     const QVoice oldVoice = d->m_engine->voice();
 
     QList<QVoice> voices;
@@ -1373,4 +2282,22 @@ QList<QVoice> QTextToSpeech::allVoices(const QLocale *locale) const
     return voices;
 }
 
+/*!
+    \internal
+
+    Returns the voices that match the indexed criteria in \a keys. For engines
+    that don't provide a catalog, only the locale is taken into account, and
+    the caller has to check the other criteria.
+*/
+QList<QVoice> QTextToSpeech::findVoicesImpl(const VoiceKeys &keys) const
+{
+    Q_D(const QTextToSpeech);
+    if (!d->m_engine)
+        return {};
+
+    if (d->ensureVoiceCatalog())
+        return d->lookupVoices(keys);
+    return allVoices(keys.locale ? &*keys.locale : nullptr);
+}
+
 QT_END_NAMESPACE
@@ -9,16 +9,20 @@
 
 #include <QtTextToSpeech/qtexttospeech_global.h>
 #include <QtTextToSpeech/qvoice.h>
+#include <QtTextToSpeech/qtexttospeechstatistics.h>
 #include <QtCore/qobject.h>
 #include <QtCore/qshareddata.h>
 #include <QtCore/qlocale.h>
 
 #include <QtCore/q20type_traits.h>
 
+#include <optional>
+
 QT_BEGIN_NAMESPACE
 
 class QAudioFormat;
 class QAudioBuffer;
+class QIODevice;
 
 class QTextToSpeechPrivate;
 class Q_TEXTTOSPEECH_EXPORT QTextToSpeech : public QObject
@@ -41,6 +45,7 @@ public:
         Paused,
         Error,
         Synthesizing,
+        Initializing,
     };
     Q_ENUM(State)
 
@@ -72,6 +77,13 @@ public:
     Q_DECLARE_FLAGS(Capabilities, Capability)
     Q_FLAG(Capabilities)
 
+    enum class FileFormat {
+        Raw,
+        Wav,
+        WavWithCuePoints,
+    };
+    Q_ENUM(FileFormat)
+
     explicit QTextToSpeech(QObject *parent = nullptr);
     explicit QTextToSpeech(const QString &engine, QObject *parent = nullptr);
     explicit QTextToSpeech(const QString &engine, const QVariantMap &params,
@@ -98,6 +110,14 @@ public:
 
     Q_INVOKABLE static QStringList availableEngines();
 
+    void setCacheCapacity(qsizetype bytes);
+    qsizetype cacheCapacity() const;
+    void setCacheDirectory(const QString &path);
+    QString cacheDirectory() const;
+    qint64 cacheHits() const;
+    qint64 cacheMisses() const;
+    void clearCache();
+
     template <typename Functor>
     void synthesize(const QString &text,
 #ifdef Q_QDOC
@@ -109,16 +129,21 @@ public:
     {
         using Prototype2 = void(*)(QAudioFormat, QByteArray);
         using Prototype1 = void(*)(QAudioBuffer);
+        using Prototype3 = void(*)(QByteArrayView, QAudioFormat, qint64);
         if constexpr (qxp::is_detected_v<CompatibleCallbackTest2, Functor>) {
             synthesizeImpl(text, QtPrivate::makeCallableObject<Prototype2>(std::forward<Functor>(func)),
                            receiver, SynthesizeOverload::AudioFormatByteArray);
         } else if constexpr (qxp::is_detected_v<CompatibleCallbackTest1, Functor>) {
             synthesizeImpl(text, QtPrivate::makeCallableObject<Prototype1>(std::forward<Functor>(func)),
                            receiver, SynthesizeOverload::AudioBuffer);
+        } else if constexpr (qxp::is_detected_v<CompatibleCallbackTest3, Functor>) {
+            synthesizeImpl(text, QtPrivate::makeCallableObject<Prototype3>(std::forward<Functor>(func)),
+                           receiver, SynthesizeOverload::ByteArrayView);
         } else {
             static_assert(QtPrivate::type_dependent_false<Functor>(),
                           "Incompatible functor signature, must be either "
-                          "(QAudioFormat, QByteArray) or (QAudioBuffer)!");
+                          "(QAudioFormat, QByteArray), (QAudioBuffer), or "
+                          "(QByteArrayView, QAudioFormat, qint64)!");
         }
     }
 
@@ -129,19 +154,47 @@ public:
         synthesize(text, nullptr, std::forward<Functor>(func));
     }
 
+    template <typename Functor>
+    void synthesizeBatch(const QStringList &texts,
+#ifdef Q_QDOC
+                         const QObject *receiver,
+#else
+                         const typename QtPrivate::ContextTypeForFunctor<Functor>::ContextType *receiver,
+# endif // Q_QDOC
+                         Functor &&func)
+    {
+        using Prototype = void(*)(qsizetype, QAudioFormat, QByteArray);
+        if constexpr (qxp::is_detected_v<CompatibleBatchCallbackTest, Functor>) {
+            synthesizeBatchImpl(texts, QtPrivate::makeCallableObject<Prototype>(std::forward<Functor>(func)),
+                                receiver);
+        } else {
+            static_assert(QtPrivate::type_dependent_false<Functor>(),
+                          "Incompatible functor signature, must be "
+                          "(qsizetype, QAudioFormat, QByteArray)!");
+        }
+    }
+
+    // synthesize a batch to a functor or function pointer (without context)
+    template <typename Functor>
+    void synthesizeBatch(const QStringList &texts, Functor &&func)
+    {
+        synthesizeBatch(texts, nullptr, std::forward<Functor>(func));
+    }
+
+    bool synthesizeToFile(const QString &text, QIODevice *device,
+                          FileFormat format = FileFormat::Wav);
+    bool synthesizeToFile(const QString &text, const QString &fileName,
+                          FileFormat format = FileFormat::Wav);
+
     template <typename ...Args>
     QList<QVoice> findVoices(Args &&...args) const
     {
-        // if any of the arguments is a locale, then we can avoid iterating through all
-        // and only have to search through the voices for that locale.
-        QLocale locale;
-        QLocale *plocale = nullptr;
-        if constexpr (std::disjunction_v<std::is_same<q20::remove_cvref_t<Args>, QLocale>...>) {
-            locale = std::get<QLocale>(std::make_tuple(args...));
-            plocale = &locale;
-        }
+        // criteria that are indexed limit the search to the voices that
+        // match those criteria; the others have to be checked for each voice.
+        VoiceKeys keys;
+        (addVoiceKey(keys, args), ...);
 
-        auto voices = allVoices(plocale);
+        auto voices = findVoicesImpl(keys);
         if constexpr (sizeof...(args) > 0)
             voices.removeIf([&](const QVoice &voice) -> bool { return !voiceMatches(voice, args...); });
         return voices;
@@ -173,24 +226,45 @@ Q_SIGNALS:
 
     void sayingWord(const QString &word, qsizetype id, qsizetype start, qsizetype length);
     void aboutToSynthesize(qsizetype id);
+    void utteranceSynthesized(qsizetype id);
+    void statisticsAvailable(const QTextToSpeechStatistics &statistics);
 
 protected:
     QList<QVoice> allVoices(const QLocale *locale) const;
 
+    // the voice properties by which voices can be looked up in the catalog
+    struct VoiceKeys
+    {
+        std::optional<QLocale> locale;
+        std::optional<QLocale::Language> language;
+        std::optional<QLocale::Territory> territory;
+        std::optional<QVoice::Gender> gender;
+        std::optional<QVoice::Age> age;
+        std::optional<QString> name;
+    };
+    QList<QVoice> findVoicesImpl(const VoiceKeys &keys) const;
+
 private:
     template <typename Functor>
     using CompatibleCallbackTest2 = decltype(QtPrivate::makeCallableObject<void(*)(QAudioFormat, QByteArray)>(std::declval<Functor>()));
     template <typename Functor>
     using CompatibleCallbackTest1 = decltype(QtPrivate::makeCallableObject<void(*)(QAudioBuffer)>(std::declval<Functor>()));
+    template <typename Functor>
+    using CompatibleCallbackTest3 = decltype(QtPrivate::makeCallableObject<void(*)(QByteArrayView, QAudioFormat, qint64)>(std::declval<Functor>()));
+    template <typename Functor>
+    using CompatibleBatchCallbackTest = decltype(QtPrivate::makeCallableObject<void(*)(qsizetype, QAudioFormat, QByteArray)>(std::declval<Functor>()));
 
     enum class SynthesizeOverload {
         AudioFormatByteArray,
-        AudioBuffer
+        AudioBuffer,
+        ByteArrayView
     };
 
     void synthesizeImpl(const QString &text,
                         QtPrivate::QSlotObjectBase *slotObj, const QObject *context,
                         SynthesizeOverload overload);
+    void synthesizeBatchImpl(const QStringList &texts,
+                             QtPrivate::QSlotObjectBase *slotObj, const QObject *context);
 
     // Helper type to find the index of a type in a tuple, which allows
     // us to generate a compile-time error if there are multiple criteria
@@ -206,6 +280,26 @@ private:
             lastIndexOf(std::make_integer_sequence<qsizetype, sizeof...(Ts)>{});
     };
 
+    template <typename Arg>
+    static void addVoiceKey(VoiceKeys &keys, const Arg &arg)
+    {
+        using ArgType = q20::remove_cvref_t<Arg>;
+        if constexpr (std::is_same_v<ArgType, QLocale>)
+            keys.locale = arg;
+        else if constexpr (std::is_same_v<ArgType, QLocale::Language>)
+            keys.language = arg;
+        else if constexpr (std::is_same_v<ArgType, QLocale::Territory>)
+            keys.territory = arg;
+        else if constexpr (std::is_same_v<ArgType, QVoice::Gender>)
+            keys.gender = arg;
+        else if constexpr (std::is_same_v<ArgType, QVoice::Age>)
+            keys.age = arg;
+        else if constexpr (std::is_convertible_v<ArgType, QString>)
+            keys.name = QString(arg);
+        else if constexpr (std::is_convertible_v<ArgType, QStringView>)
+            keys.name = QStringView(arg).toString();
+    }
+
     template <typename Arg0, typename ...Args>
     bool voiceMatches(const QVoice &voice, Arg0 &&arg0, Args &&...args) const {
         using ArgType = q20::remove_cvref_t<Arg0>;
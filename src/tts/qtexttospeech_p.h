@@ -19,10 +19,15 @@
 
 #include <qtexttospeech.h>
 #include <qtexttospeechplugin.h>
+#include "qtexttospeechcache_p.h"
+#include "qtexttospeechfilewriter_p.h"
+#include "qtexttospeechstatistics_p.h"
 #include <QMutex>
 #include <QCborMap>
+#include <QtCore/qelapsedtimer.h>
 #include <QtCore/qhash.h>
 #include <QtCore/qqueue.h>
+#include <QtCore/qthread.h>
 #include <QtCore/qnumeric.h>
 #include <QtCore/private/qobject_p.h>
 
@@ -38,29 +43,107 @@ public:
 
     void setEngineProvider(const QString &engine, const QVariantMap &params);
     static QMultiHash<QString, QCborMap> plugins(bool reload = false);
+    static QStringList providers();
 
 private:
     bool loadMeta();
     void loadPlugin();
+    void startEngineInitialization(const QVariantMap &params);
+    void cancelEngineInitialization();
+    void engineInitialized(quint64 generation);
+    void setupEngine();
+    void restoreEngineSettings();
     void updateState(QTextToSpeech::State newState);
     void disconnectSynthesizeFunctor();
-    static void loadPluginMetadata(QMultiHash<QString, QCborMap> &list);
+
+    // dispatch to the engine, or to the cache
+    void sayText(const QString &text);
+    void synthesizeText(const QString &text);
+    void prepareUpcomingTexts();
+    QTextToSpeech::State engineState() const;
+    void engineStateChanged(QTextToSpeech::State newState);
+    void engineSayingWord(const QString &word, qsizetype start, qsizetype length);
+    void engineSynthesized(const QAudioFormat &format, const QByteArray &data);
+    void engineUtteranceSynthesized(qsizetype index);
+    void engineAudioWritten(const QAudioFormat &format, qint64 bytes);
+    void startStatistics();
+    void finishStatistics();
+    bool ensureVoiceCatalog() const;
+    void resetVoiceCatalog();
+    QList<QVoice> lookupVoices(const QTextToSpeech::VoiceKeys &keys) const;
+    QTextToSpeechCachePlayer *cachePlayer();
+    bool cachePlayerActive() const;
+    QByteArray cacheKey(const QString &text) const;
+    void startRecording(const QByteArray &key, const QString &text, bool forSay);
+    void cancelRecording();
+    bool startFileWriter(const QString &text, std::unique_ptr<QTextToSpeechFileWriter> &&writer);
+    void finishFileWriter();
+
+    static void discoverPlugins(bool reload);
     QTextToSpeech *q_ptr;
     QTextToSpeechPlugin *m_plugin = nullptr;
     std::unique_ptr<QTextToSpeechEngine> m_engine = nullptr;
+    // the engine that is being constructed by m_initThread
+    std::unique_ptr<QThread> m_initThread;
+    std::unique_ptr<QTextToSpeechEngine> m_initEngine;
+    QString m_initErrorString;
+    quint64 m_initGeneration = 0;
     QString m_providerName;
     QCborMap m_metaData;
     static QMutex m_mutex;
     QQueue<QString> m_pendingUtterances;
+    // the pending texts that the engine was last asked to prepare; the look-ahead
+    // is limited, so that enqueue() doesn't get slower with long queues
+    static constexpr qsizetype MaxPreparedTexts = 16;
+    QStringList m_preparedTexts;
     QTextToSpeech::State m_state = QTextToSpeech::Error;
     QMetaObject::Connection m_synthesizeConnection;
     QtPrivate::QSlotObjectBase *m_slotObject = nullptr;
+    // how the texts passed to synthesizeBatch() are processed
+    enum class BatchMode {
+        None,
+        Engine,
+        Queue
+    } m_batchMode = BatchMode::None;
 
     qsizetype m_utteranceCounter = 0;
     qsizetype m_currentUtterance = 0;
+    // duration of the data synthesized so far for the current utterance
+    qint64 m_synthesizedTime = 0;
     double m_storedPitch = qQNaN();
     double m_storedVolume = qQNaN();
     double m_storedRate = qQNaN();
+
+    QTextToSpeechCache m_cache;
+    std::unique_ptr<QTextToSpeechCachePlayer> m_cachePlayer;
+    QMetaObject::Connection m_cacheSynthesizeConnection;
+    QAudioDevice m_audioDevice;
+    // the engine output for a text that is not in the cache yet
+    QByteArray m_recordingKey;
+    QString m_recordingText;
+    QTextToSpeechCache::Entry m_recording;
+    bool m_recordingForSay = false;
+    bool m_recordingValid = false;
+
+    // measurements for the text the engine is processing, if the timer is valid
+    QTextToSpeechStatistics m_statistics;
+    QElapsedTimer m_statisticsTimer;
+
+    // all voices of the engine, and for each property value the positions of
+    // the voices with that value in that list; built on first use, and reset
+    // when the engine reports a change
+    mutable QList<QVoice> m_voiceCatalog;
+    mutable QHash<QLocale, QList<qsizetype>> m_voicesByLocale;
+    mutable QHash<QLocale::Language, QList<qsizetype>> m_voicesByLanguage;
+    mutable QHash<QLocale::Territory, QList<qsizetype>> m_voicesByTerritory;
+    mutable QHash<QVoice::Gender, QList<qsizetype>> m_voicesByGender;
+    mutable QHash<QVoice::Age, QList<qsizetype>> m_voicesByAge;
+    mutable QHash<QString, QList<qsizetype>> m_voicesByName;
+    mutable bool m_voiceCatalogValid = false;
+
+    // the output of synthesizeToFile()
+    std::unique_ptr<QTextToSpeechFileWriter> m_fileWriter;
+    QMetaObject::Connection m_fileWriterConnection;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,267 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechaudioconverter_p.h"
+#include "qtexttospeechdsp_p.h"
+
+#include <QtCore/qmath.h>
+
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+// Zero crossings of the sinc function on each side of the filter's center
+constexpr int ZeroCrossings = 16;
+// Cutoff frequency, relative to the Nyquist frequency of the lower sample rate
+constexpr double Cutoff = 0.9;
+constexpr double KaiserBeta = 8.0;
+// Limits the size of the filter for sample rates without a large common divisor
+constexpr int MaxPhases = 1024;
+constexpr int MaxTaps = 256;
+
+// Modified Bessel function of the first kind, for the Kaiser window
+double besselI0(double x)
+{
+    double sum = 1;
+    double term = 1;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+template <typename T> float toFloat(T sample);
+template <> float toFloat(quint8 sample) { return (int(sample) - 128) / 128.f; }
+template <> float toFloat(qint16 sample) { return sample / 32768.f; }
+template <> float toFloat(qint32 sample) { return float(sample / 2147483648.); }
+template <> float toFloat(float sample) { return sample; }
+
+template <typename T> T fromFloat(float sample);
+template <> quint8 fromFloat(float sample)
+{
+    return quint8(qBound(0, qRound(sample * 128.f) + 128, 255));
+}
+template <> qint16 fromFloat(float sample)
+{
+    return qint16(qBound(-32768, qRound(sample * 32768.f), 32767));
+}
+template <> qint32 fromFloat(float sample)
+{
+    return qint32(qBound(-2147483648., std::round(sample * 2147483648.), 2147483647.));
+}
+template <> float fromFloat(float sample) { return sample; }
+
+// Appends the frames to the channels, mixing down to a single channel
+template <typename T>
+void readSamples(const char *data, qsizetype frames, int inputChannels,
+                 QList<QList<float>> &channels)
+{
+    const T *samples = reinterpret_cast<const T *>(data);
+    const int channelCount = int(channels.size());
+    for (int c = 0; c < channelCount; ++c) {
+        QList<float> &channel = channels[c];
+        const qsizetype offset = channel.size();
+        channel.resize(offset + frames);
+        float *out = channel.data() + offset;
+        if (channelCount == 1 && inputChannels > 1) {
+            for (qsizetype f = 0; f < frames; ++f) {
+                float sum = 0;
+                for (int i = 0; i < inputChannels; ++i)
+                    sum += toFloat(samples[f * inputChannels + i]);
+                out[f] = sum / inputChannels;
+            }
+        } else {
+            for (qsizetype f = 0; f < frames; ++f)
+                out[f] = toFloat(samples[f * inputChannels + c]);
+        }
+    }
+}
+
+// Interleaves the channels, copying a single channel to all output channels,
+// and leaving additional channels silent otherwise
+template <typename T>
+void writeSamples(const QList<QList<float>> &channels, qsizetype frames, int outputChannels,
+                  char *data)
+{
+    T *samples = reinterpret_cast<T *>(data);
+    const int channelCount = int(channels.size());
+    for (int c = 0; c < outputChannels; ++c) {
+        if (c >= channelCount && channelCount > 1) {
+            for (qsizetype f = 0; f < frames; ++f)
+                samples[f * outputChannels + c] = fromFloat<T>(0);
+            continue;
+        }
+        const float *in = channels.at(qMin(c, channelCount - 1)).constData();
+        for (qsizetype f = 0; f < frames; ++f)
+            samples[f * outputChannels + c] = fromFloat<T>(in[f]);
+    }
+}
+
+bool isSupported(const QAudioFormat &format)
+{
+    return format.isValid() && format.sampleFormat() != QAudioFormat::Unknown;
+}
+}
+
+QTextToSpeechAudioConverter::QTextToSpeechAudioConverter(const QAudioFormat &inputFormat,
+                                                         const QAudioFormat &outputFormat)
+    : m_inputFormat(inputFormat), m_outputFormat(outputFormat)
+{
+    if (!isSupported(inputFormat) || !isSupported(outputFormat))
+        return;
+
+    m_channelCount = qMin(inputFormat.channelCount(), outputFormat.channelCount());
+    const int divisor = std::gcd(inputFormat.sampleRate(), outputFormat.sampleRate());
+    m_upFactor = outputFormat.sampleRate() / divisor;
+    m_downFactor = inputFormat.sampleRate() / divisor;
+    if (m_upFactor > MaxPhases)
+        return;
+
+    if (m_upFactor != m_downFactor)
+        createFilter();
+    m_input.resize(m_channelCount);
+    m_output.resize(m_channelCount);
+    m_valid = true;
+    reset();
+}
+
+/*
+    The prototype filter is a Kaiser-windowed sinc at the upsampled rate, with the
+    cutoff below the Nyquist frequency of the lower of the two sample rates. Each
+    phase holds every m_upFactor'th coefficient in reverse order, so that an output
+    sample is the dot product of one phase with consecutive input samples.
+*/
+void QTextToSpeechAudioConverter::createFilter()
+{
+    const int rateFactor = qMax(m_upFactor, m_downFactor);
+    const double cutoff = Cutoff / (2.0 * rateFactor);
+    const int taps = int(std::ceil(2.0 * ZeroCrossings * rateFactor / (Cutoff * m_upFactor)));
+    // a multiple of four, for the vectorized dot product
+    m_taps = qMin((taps + 3) & ~3, MaxTaps);
+
+    // An odd length puts the center of the filter on a sample of the upsampled
+    // rate; the last coefficient of the last phase stays zero.
+    const qsizetype length = qsizetype(m_taps) * m_upFactor - 1;
+    const double center = (length - 1) / 2;
+    const double window = besselI0(KaiserBeta);
+    m_coefficients.fill(0, length + 1);
+    for (qsizetype n = 0; n < length; ++n) {
+        const double t = n - center;
+        const double sinc = qFuzzyIsNull(t) ? 2 * cutoff
+                                            : std::sin(2 * M_PI * cutoff * t) / (M_PI * t);
+        const double x = 2.0 * n / (length - 1) - 1;
+        const double kaiser = besselI0(KaiserBeta * std::sqrt(qMax(0.0, 1 - x * x))) / window;
+        const int phase = int(n % m_upFactor);
+        const int tap = int(n / m_upFactor);
+        m_coefficients[phase * m_taps + (m_taps - 1 - tap)] = float(sinc * kaiser * m_upFactor);
+    }
+}
+
+void QTextToSpeechAudioConverter::reset()
+{
+    for (QList<float> &channel : m_input)
+        channel.fill(0, qMax(m_taps - 1, 0));
+    // Starting at the delay of the filter aligns the first output sample with
+    // the first input sample
+    m_time = m_taps ? (qint64(m_taps) * m_upFactor - 2) / 2 : 0;
+}
+
+void QTextToSpeechAudioConverter::convert(QByteArrayView input, QByteArray &output,
+                                          bool endOfStream)
+{
+    // keeps the capacity of output, which callers reuse for every chunk
+    output.resize(0);
+    if (!m_valid)
+        return;
+
+    readFrames(input.data(), input.size() / m_inputFormat.bytesPerFrame());
+    resample(endOfStream);
+    writeFrames(output);
+    if (endOfStream)
+        reset();
+}
+
+void QTextToSpeechAudioConverter::readFrames(const char *data, qsizetype frames)
+{
+    const int inputChannels = m_inputFormat.channelCount();
+    switch (m_inputFormat.sampleFormat()) {
+    case QAudioFormat::UInt8:
+        readSamples<quint8>(data, frames, inputChannels, m_input);
+        break;
+    case QAudioFormat::Int16:
+        readSamples<qint16>(data, frames, inputChannels, m_input);
+        break;
+    case QAudioFormat::Int32:
+        readSamples<qint32>(data, frames, inputChannels, m_input);
+        break;
+    case QAudioFormat::Float:
+        readSamples<float>(data, frames, inputChannels, m_input);
+        break;
+    case QAudioFormat::Unknown:
+    case QAudioFormat::NSampleFormats:
+        break;
+    }
+}
+
+void QTextToSpeechAudioConverter::resample(bool endOfStream)
+{
+    if (!m_taps) {
+        for (int c = 0; c < m_channelCount; ++c)
+            m_output[c] = std::exchange(m_input[c], {});
+        return;
+    }
+
+    // Silence after the end of the stream pushes the last samples through the filter
+    const qsizetype padding = endOfStream ? m_taps / 2 + 1 : 0;
+    const qsizetype available = m_input.first().size() - (m_taps - 1) + padding;
+    qint64 time = m_time;
+    for (int c = 0; c < m_channelCount; ++c) {
+        QList<float> &input = m_input[c];
+        QList<float> &output = m_output[c];
+        input.resize(input.size() + padding);
+        output.clear();
+        output.reserve(qsizetype(available * m_upFactor / m_downFactor) + 1);
+        time = m_time;
+        for (; time / m_upFactor < available; time += m_downFactor) {
+            const qsizetype base = qsizetype(time / m_upFactor);
+            const int phase = int(time % m_upFactor);
+            output.append(QTextToSpeechDsp::dotProduct(
+                    m_coefficients.constData() + phase * m_taps, input.constData() + base,
+                    m_taps));
+        }
+        input.remove(0, available);
+    }
+    m_time = time - qint64(available) * m_upFactor;
+}
+
+void QTextToSpeechAudioConverter::writeFrames(QByteArray &output)
+{
+    const qsizetype frames = m_channelCount ? m_output.first().size() : 0;
+    output.resize(frames * m_outputFormat.bytesPerFrame());
+    const int outputChannels = m_outputFormat.channelCount();
+    switch (m_outputFormat.sampleFormat()) {
+    case QAudioFormat::UInt8:
+        writeSamples<quint8>(m_output, frames, outputChannels, output.data());
+        break;
+    case QAudioFormat::Int16:
+        writeSamples<qint16>(m_output, frames, outputChannels, output.data());
+        break;
+    case QAudioFormat::Int32:
+        writeSamples<qint32>(m_output, frames, outputChannels, output.data());
+        break;
+    case QAudioFormat::Float:
+        writeSamples<float>(m_output, frames, outputChannels, output.data());
+        break;
+    case QAudioFormat::Unknown:
+    case QAudioFormat::NSampleFormats:
+        break;
+    }
+}
+
+QT_END_NAMESPACE
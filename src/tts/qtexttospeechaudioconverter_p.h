@@ -0,0 +1,79 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHAUDIOCONVERTER_P_H
+#define QTEXTTOSPEECHAUDIOCONVERTER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeech_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qbytearrayview.h>
+#include <QtCore/qlist.h>
+#include <QtMultimedia/qaudioformat.h>
+
+QT_BEGIN_NAMESPACE
+
+// Converts a stream of PCM data into a different sample format, channel count
+// and sample rate, for engines whose output doesn't match the audio device or
+// the format requested by the application. Mono data gets copied to all output
+// channels, and data with more channels gets mixed down to mono, or the extra
+// channels get dropped. The sample rate is converted with a polyphase
+// windowed-sinc filter.
+class Q_TEXTTOSPEECH_EXPORT QTextToSpeechAudioConverter
+{
+public:
+    QTextToSpeechAudioConverter(const QAudioFormat &inputFormat, const QAudioFormat &outputFormat);
+
+    bool isValid() const { return m_valid; }
+    QAudioFormat inputFormat() const { return m_inputFormat; }
+    QAudioFormat outputFormat() const { return m_outputFormat; }
+
+    // Converts input, which must consist of whole frames, and replaces the content
+    // of output with the result. The resampler holds back the last input samples
+    // until more data arrives; with endOfStream, they are included in output, and
+    // the converter is reset for the next stream.
+    void convert(QByteArrayView input, QByteArray &output, bool endOfStream = false);
+    void reset();
+
+private:
+    void createFilter();
+    void readFrames(const char *data, qsizetype frames);
+    void resample(bool endOfStream);
+    void writeFrames(QByteArray &output);
+
+    QAudioFormat m_inputFormat;
+    QAudioFormat m_outputFormat;
+    bool m_valid = false;
+    // the channels that get resampled, the smaller of the input and output channel count
+    int m_channelCount = 0;
+
+    // The sample rate gets multiplied by m_upFactor and divided by m_downFactor;
+    // m_coefficients holds m_upFactor phases of m_taps coefficients each
+    int m_upFactor = 1;
+    int m_downFactor = 1;
+    int m_taps = 0;
+    QList<float> m_coefficients;
+    // position of the next output sample, in input samples times m_upFactor,
+    // relative to the first input sample that has not been consumed
+    qint64 m_time = 0;
+
+    // per channel; the input starts with the last m_taps - 1 samples of the
+    // previous call
+    QList<QList<float>> m_input;
+    QList<QList<float>> m_output;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,372 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechcache_p.h"
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qdiriterator.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qsavefile.h>
+#include <QtCore/qtimer.h>
+#include <QtMultimedia/qaudiosink.h>
+#include <QtMultimedia/qmediadevices.h>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Qt::StringLiterals;
+
+namespace {
+constexpr quint32 CacheFileMagic = 0x51545343; // "QTSC"
+constexpr quint16 CacheFileVersion = 1;
+constexpr QLatin1StringView CacheFileSuffix = ".ttscache"_L1;
+}
+
+/*
+    QTextToSpeechCache stores the PCM data, and the timeline of words, for
+    texts synthesized by an engine. Entries are kept in a cost-bounded LRU
+    in memory, and optionally in files in a directory.
+*/
+QByteArray QTextToSpeechCache::key(const QString &engine, const QVoice &voice,
+                                   double rate, double pitch, double volume,
+                                   const QString &text)
+{
+    QByteArray keyData;
+    QDataStream stream(&keyData, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << engine << voice << rate << pitch << volume << text;
+    return QCryptographicHash::hash(keyData, QCryptographicHash::Sha1);
+}
+
+std::optional<QTextToSpeechCache::Entry> QTextToSpeechCache::find(const QByteArray &key)
+{
+    if (const Entry *entry = m_memory.object(key)) {
+        ++m_hits;
+        return *entry;
+    }
+    if (auto entry = read(key)) {
+        ++m_hits;
+        m_memory.insert(key, new Entry(*entry), entry->data.size());
+        return entry;
+    }
+    ++m_misses;
+    return std::nullopt;
+}
+
+void QTextToSpeechCache::insert(const QByteArray &key, const Entry &entry)
+{
+    m_memory.insert(key, new Entry(entry), entry.data.size());
+    write(key, entry);
+}
+
+void QTextToSpeechCache::clear()
+{
+    m_memory.clear();
+    if (m_directory.isEmpty())
+        return;
+    QDirIterator it(m_directory, {u'*' + CacheFileSuffix}, QDir::Files);
+    while (it.hasNext())
+        QFile::remove(it.next());
+}
+
+QString QTextToSpeechCache::fileName(const QByteArray &key) const
+{
+    return QDir(m_directory).filePath(QString::fromLatin1(key.toHex()) + CacheFileSuffix);
+}
+
+std::optional<QTextToSpeechCache::Entry> QTextToSpeechCache::read(const QByteArray &key) const
+{
+    if (m_directory.isEmpty())
+        return std::nullopt;
+
+    QFile file(fileName(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return std::nullopt;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != CacheFileMagic || version != CacheFileVersion)
+        return std::nullopt;
+
+    Entry entry;
+    qint32 sampleRate = 0;
+    qint32 channelCount = 0;
+    qint32 sampleFormat = 0;
+    qint64 wordCount = 0;
+    stream >> sampleRate >> channelCount >> sampleFormat >> wordCount;
+    entry.format.setSampleRate(sampleRate);
+    entry.format.setChannelCount(channelCount);
+    entry.format.setSampleFormat(QAudioFormat::SampleFormat(sampleFormat));
+    for (qint64 i = 0; i < wordCount && stream.status() == QDataStream::Ok; ++i) {
+        Word word;
+        qint64 start = 0;
+        qint64 length = 0;
+        stream >> word.time >> word.word >> start >> length;
+        word.start = start;
+        word.length = length;
+        entry.words.append(word);
+    }
+    stream >> entry.data;
+
+    if (stream.status() != QDataStream::Ok || !entry.format.isValid())
+        return std::nullopt;
+    return entry;
+}
+
+void QTextToSpeechCache::write(const QByteArray &key, const Entry &entry) const
+{
+    if (m_directory.isEmpty() || !QDir().mkpath(m_directory))
+        return;
+
+    QSaveFile file(fileName(key));
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << CacheFileMagic << CacheFileVersion
+           << qint32(entry.format.sampleRate()) << qint32(entry.format.channelCount())
+           << qint32(entry.format.sampleFormat()) << qint64(entry.words.size());
+    for (const Word &word : entry.words)
+        stream << word.time << word.word << qint64(word.start) << qint64(word.length);
+    stream << entry.data;
+
+    if (stream.status() == QDataStream::Ok)
+        file.commit();
+}
+
+/*
+    QTextToSpeechCachePlayer replays cache entries, either by playing the audio
+    data to an audio device, or by delivering it asynchronously through the
+    synthesized() signal. It emits the same signals as a QTextToSpeechEngine.
+*/
+QTextToSpeechCachePlayer::QTextToSpeechCachePlayer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+QTextToSpeechCachePlayer::~QTextToSpeechCachePlayer()
+{
+    abort();
+}
+
+void QTextToSpeechCachePlayer::say(const QTextToSpeechCache::Entry &entry, double volume)
+{
+    abort();
+    m_entry = entry;
+    startSink(volume);
+}
+
+void QTextToSpeechCachePlayer::startSink(double volume)
+{
+    const QAudioDevice device = m_audioDevice.isNull() ? QMediaDevices::defaultAudioOutput()
+                                                       : m_audioDevice;
+    if (device.isNull()) {
+        setError(QCoreApplication::translate("QTextToSpeech", "No audio device available"));
+        return;
+    }
+
+    m_audioSink = new QAudioSink(device, m_entry.format, this);
+    m_audioSink->setVolume(volume);
+    connect(m_audioSink, &QAudioSink::stateChanged,
+            this, &QTextToSpeechCachePlayer::sinkStateChanged);
+    // reads m_entry.data directly, which grows while streaming
+    m_buffer.setBuffer(&m_entry.data);
+    m_buffer.open(QIODevice::ReadOnly);
+    m_audioSink->start(&m_buffer);
+    // the sink reports the Active state asynchronously
+    if (m_audioSink)
+        setState(QTextToSpeech::Speaking);
+}
+
+void QTextToSpeechCachePlayer::startStream(double volume)
+{
+    abort();
+    m_entry = {};
+    m_streamVolume = volume;
+    m_streaming = true;
+}
+
+// The sink starts with the first data; it keeps pulling from the buffer when
+// it runs out of data, so later data continues the playback
+void QTextToSpeechCachePlayer::appendStream(const QAudioFormat &format, const QByteArray &data)
+{
+    if (!m_streaming)
+        return;
+    if (!m_audioSink) {
+        m_entry.format = format;
+        m_entry.data += data;
+        startSink(m_streamVolume);
+        return;
+    }
+    // the sink can't change the format; the recording isn't cached then either
+    if (format == m_entry.format)
+        m_entry.data += data;
+}
+
+void QTextToSpeechCachePlayer::appendStreamWord(const QTextToSpeechCache::Word &word)
+{
+    if (!m_streaming)
+        return;
+    m_entry.words.append(word);
+    if (m_audioSink && m_state == QTextToSpeech::Speaking && !m_wordTimer.isActive())
+        startWordTimer();
+}
+
+void QTextToSpeechCachePlayer::finishStream()
+{
+    if (!m_streaming)
+        return;
+    m_streaming = false;
+    if (!m_audioSink)
+        abort();
+    else if (m_audioSink->state() == QAudio::IdleState && m_buffer.atEnd())
+        sinkStateChanged(QAudio::IdleState);
+}
+
+void QTextToSpeechCachePlayer::synthesize(const QTextToSpeechCache::Entry &entry)
+{
+    abort();
+    m_entry = entry;
+    setState(QTextToSpeech::Synthesizing);
+    QMetaObject::invokeMethod(this, &QTextToSpeechCachePlayer::deliver, Qt::QueuedConnection);
+}
+
+// Deliver the data in chunks between words, like an engine would
+void QTextToSpeechCachePlayer::deliver()
+{
+    if (m_state != QTextToSpeech::Synthesizing)
+        return;
+
+    const QTextToSpeechCache::Entry entry = m_entry;
+    qsizetype offset = 0;
+    for (const auto &word : entry.words) {
+        const qsizetype wordOffset = qMin(entry.format.bytesForDuration(word.time),
+                                          entry.data.size());
+        if (wordOffset > offset) {
+            emit synthesized(entry.format, entry.data.sliced(offset, wordOffset - offset));
+            offset = wordOffset;
+        }
+        emit sayingWord(word.word, word.start, word.length);
+        // a receiver might have stopped us
+        if (m_state != QTextToSpeech::Synthesizing)
+            return;
+    }
+    if (offset < entry.data.size())
+        emit synthesized(entry.format, entry.data.sliced(offset));
+    if (m_state == QTextToSpeech::Synthesizing)
+        setState(QTextToSpeech::Ready);
+}
+
+void QTextToSpeechCachePlayer::stop()
+{
+    if (m_state == QTextToSpeech::Ready)
+        return;
+    abort();
+    setState(QTextToSpeech::Ready);
+}
+
+// Stops without emitting any signal
+void QTextToSpeechCachePlayer::abort()
+{
+    m_wordTimer.stop();
+    m_currentWord = 0;
+    if (m_audioSink) {
+        m_audioSink->disconnect(this);
+        m_audioSink->stop();
+        // we might be called from a slot connected to the sink
+        m_audioSink->deleteLater();
+        m_audioSink = nullptr;
+    }
+    m_buffer.close();
+    m_streaming = false;
+    m_state = QTextToSpeech::Ready;
+}
+
+void QTextToSpeechCachePlayer::pause()
+{
+    if (m_audioSink && m_state == QTextToSpeech::Speaking)
+        m_audioSink->suspend();
+}
+
+void QTextToSpeechCachePlayer::resume()
+{
+    if (m_audioSink && m_state == QTextToSpeech::Paused)
+        m_audioSink->resume();
+}
+
+void QTextToSpeechCachePlayer::setState(QTextToSpeech::State state)
+{
+    if (m_state == state)
+        return;
+    m_state = state;
+    emit stateChanged(m_state);
+}
+
+void QTextToSpeechCachePlayer::setError(const QString &errorString)
+{
+    abort();
+    m_errorString = errorString;
+    setState(QTextToSpeech::Error);
+    emit errorOccurred(QTextToSpeech::ErrorReason::Playback, m_errorString);
+}
+
+void QTextToSpeechCachePlayer::sinkStateChanged(QAudio::State state)
+{
+    switch (state) {
+    case QAudio::ActiveState:
+        setState(QTextToSpeech::Speaking);
+        startWordTimer();
+        break;
+    case QAudio::SuspendedState:
+        m_wordTimer.stop();
+        setState(QTextToSpeech::Paused);
+        break;
+    case QAudio::IdleState:
+    case QAudio::StoppedState:
+        if (const QAudio::Error error = m_audioSink->error();
+            error != QAudio::NoError && error != QAudio::UnderrunError) {
+            setError(QCoreApplication::translate("QTextToSpeech", "Audio streaming error."));
+            break;
+        }
+        // the engine is still synthesizing
+        if (m_streaming && state == QAudio::IdleState) {
+            m_wordTimer.stop();
+            break;
+        }
+        // all data has been played
+        abort();
+        emit stateChanged(m_state);
+        break;
+    }
+}
+
+void QTextToSpeechCachePlayer::startWordTimer()
+{
+    if (m_currentWord >= m_entry.words.size())
+        return;
+    const qint64 playedTime = m_audioSink->processedUSecs();
+    const qint64 wordTime = m_entry.words.at(m_currentWord).time;
+    m_wordTimer.start(int(qMax(wordTime - playedTime, 0ll) / 1000), Qt::PreciseTimer, this);
+}
+
+void QTextToSpeechCachePlayer::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_wordTimer.timerId()) {
+        QObject::timerEvent(event);
+        return;
+    }
+
+    m_wordTimer.stop();
+    const auto &word = m_entry.words.at(m_currentWord++);
+    emit sayingWord(word.word, word.start, word.length);
+    if (m_audioSink && m_state == QTextToSpeech::Speaking)
+        startWordTimer();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,136 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHCACHE_P_H
+#define QTEXTTOSPEECHCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeech.h>
+
+#include <QtCore/qbasictimer.h>
+#include <QtCore/qbuffer.h>
+#include <QtCore/qcache.h>
+#include <QtCore/qobject.h>
+#include <QtMultimedia/qaudioformat.h>
+#include <QtMultimedia/qaudiodevice.h>
+#include <QtMultimedia/qaudio.h>
+
+#include <optional>
+
+QT_BEGIN_NAMESPACE
+
+class QAudioSink;
+
+class QTextToSpeechCache
+{
+public:
+    struct Word
+    {
+        qint64 time; // in microseconds from the start of the audio data
+        QString word;
+        qsizetype start;
+        qsizetype length;
+    };
+
+    struct Entry
+    {
+        QAudioFormat format;
+        QByteArray data;
+        QList<Word> words;
+    };
+
+    static QByteArray key(const QString &engine, const QVoice &voice,
+                          double rate, double pitch, double volume, const QString &text);
+
+    bool isEnabled() const { return capacity() > 0 || !m_directory.isEmpty(); }
+    qsizetype capacity() const { return m_memory.maxCost(); }
+    void setCapacity(qsizetype capacity) { m_memory.setMaxCost(capacity); }
+    QString directory() const { return m_directory; }
+    void setDirectory(const QString &directory) { m_directory = directory; }
+
+    std::optional<Entry> find(const QByteArray &key);
+    void insert(const QByteArray &key, const Entry &entry);
+    void clear();
+
+    qint64 hits() const { return m_hits; }
+    qint64 misses() const { return m_misses; }
+
+private:
+    QString fileName(const QByteArray &key) const;
+    std::optional<Entry> read(const QByteArray &key) const;
+    void write(const QByteArray &key, const Entry &entry) const;
+
+    QCache<QByteArray, Entry> m_memory{0};
+    QString m_directory;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+// Replays cached entries through the same signals that an engine uses
+class QTextToSpeechCachePlayer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QTextToSpeechCachePlayer(QObject *parent = nullptr);
+    ~QTextToSpeechCachePlayer() override;
+
+    void setAudioDevice(const QAudioDevice &device) { m_audioDevice = device; }
+
+    void say(const QTextToSpeechCache::Entry &entry, double volume);
+    void synthesize(const QTextToSpeechCache::Entry &entry);
+    // Plays data while an engine synthesizes it; the data and the words are
+    // appended as they arrive, until finishStream() is called
+    void startStream(double volume);
+    void appendStream(const QAudioFormat &format, const QByteArray &data);
+    void appendStreamWord(const QTextToSpeechCache::Word &word);
+    void finishStream();
+    void stop();
+    void abort();
+    void pause();
+    void resume();
+
+    QTextToSpeech::State state() const { return m_state; }
+    QString errorString() const { return m_errorString; }
+
+Q_SIGNALS:
+    void stateChanged(QTextToSpeech::State state);
+    void errorOccurred(QTextToSpeech::ErrorReason error, const QString &errorString);
+    void sayingWord(const QString &word, qsizetype start, qsizetype length);
+    void synthesized(const QAudioFormat &format, const QByteArray &data);
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    void setState(QTextToSpeech::State state);
+    void setError(const QString &errorString);
+    void startSink(double volume);
+    void sinkStateChanged(QAudio::State state);
+    void deliver();
+    void startWordTimer();
+
+    QAudioDevice m_audioDevice;
+    QAudioSink *m_audioSink = nullptr;
+    QBuffer m_buffer;
+    QTextToSpeechCache::Entry m_entry;
+    double m_streamVolume = 1.0;
+    bool m_streaming = false;
+    qsizetype m_currentWord = 0;
+    QBasicTimer m_wordTimer;
+    QTextToSpeech::State m_state = QTextToSpeech::Ready;
+    QString m_errorString;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,54 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHDSP_P_H
+#define QTEXTTOSPEECHDSP_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeech_global.h>
+
+#include <QtCore/private/qsimd_p.h>
+
+QT_BEGIN_NAMESPACE
+
+// Signal processing helpers of the audio converter and the time stretcher
+namespace QTextToSpeechDsp {
+
+inline float dotProduct(const float *a, const float *b, qsizetype count)
+{
+    qsizetype i = 0;
+    float result = 0;
+#if defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    result = _mm_cvtss_f32(sum);
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    float32x4_t sum = vdupq_n_f32(0);
+    for (; i + 4 <= count; i += 4)
+        sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+    const float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    result = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+    for (; i < count; ++i)
+        result += a[i] * b[i];
+    return result;
+}
+
+} // namespace QTextToSpeechDsp
+
+QT_END_NAMESPACE
+
+#endif
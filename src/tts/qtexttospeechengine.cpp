@@ -37,12 +37,73 @@ QT_BEGIN_NAMESPACE
     Implementation of \l QTextToSpeech::availableVoices().
 */
 
+/*!
+    \since 6.9
+
+    Returns the voices for all locales, ordered by locale as returned by
+    availableLocales(), and for each locale in the same order as
+    availableVoices() would return them.
+
+    QTextToSpeech caches this list to look up voices without having to change
+    the engine's locale, and only reads it again when the engine emits
+    voicesChanged(). Engines that know all their voices should therefore
+    reimplement this function.
+
+    The default implementation returns an empty list, in which case
+    QTextToSpeech sets each available locale on the engine and collects the
+    voices from availableVoices().
+*/
+QList<QVoice> QTextToSpeechEngine::allVoices() const
+{
+    return {};
+}
+
 /*!
     \fn void QTextToSpeechEngine::say(const QString &text)
 
     Implementation of \l {QTextToSpeech::say()}{QTextToSpeech::say}(\a text).
 */
 
+/*!
+    \since 6.9
+
+    Implementation of \l {QTextToSpeech::synthesizeBatch()}{QTextToSpeech::synthesizeBatch}(\a texts).
+
+    Engines that can synthesize several texts more efficiently than one after
+    the other, for instance by processing them in parallel, can reimplement this
+    function and return \c true. The implementation must emit synthesized()
+    for the data of all \a texts in order, emit utteranceSynthesized() with the
+    index of each text in \a texts once all data of that text has been emitted,
+    and change the state to QTextToSpeech::Ready once all texts are done.
+
+    The default implementation returns \c false, in which case QTextToSpeech
+    calls synthesize() for each text.
+*/
+bool QTextToSpeechEngine::synthesizeBatch(const QStringList &texts)
+{
+    Q_UNUSED(texts);
+    return false;
+}
+
+/*!
+    \since 6.9
+
+    Called with the \a texts that QTextToSpeech will pass to say() next, in
+    order, whenever that list changes. For long queues, only the first few
+    texts are passed. An empty list means that no texts are queued anymore.
+
+    Engines can reimplement this function to synthesize some of these texts
+    while the current text is still being spoken, so that they can start
+    speaking the next text without delay. The voice attributes might still
+    change before say() gets called for a text.
+
+    The default implementation does nothing.
+*/
+void QTextToSpeechEngine::prepare(const QStringList &texts)
+{
+    Q_UNUSED(texts);
+}
+
 /*!
     \fn void QTextToSpeechEngine::stop(QTextToSpeech::BoundaryHint hint)
 
@@ -147,6 +208,34 @@ QT_BEGIN_NAMESPACE
     This signal is connected to QTextToSpeech::stateChanged() signal.
 */
 
+/*!
+    \fn void QTextToSpeechEngine::utteranceSynthesized(qsizetype index)
+    \since 6.9
+
+    Emitted by engines that implement synthesizeBatch() when all data for the
+    text at \a index has been emitted through synthesized().
+*/
+
+/*!
+    \fn void QTextToSpeechEngine::audioWritten(const QAudioFormat &format, qint64 bytes)
+    \since 6.9
+
+    Emitted by engines that play the audio themselves when they have written
+    \a bytes of audio data in \a format to the audio output while speaking.
+
+    QTextToSpeech uses this signal for the QTextToSpeechStatistics of spoken
+    texts; data that the engine emits through synthesized() while speaking is
+    not counted.
+*/
+
+/*!
+    \fn void QTextToSpeechEngine::voicesChanged()
+    \since 6.9
+
+    Emitted by engines when the list of voices returned by allVoices() has
+    changed, for instance because a voice got installed.
+*/
+
 /*!
     Constructs the text-to-speech engine base class with \a parent.
 */
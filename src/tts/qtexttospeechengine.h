@@ -60,6 +60,10 @@ public:
     virtual QTextToSpeech::ErrorReason errorReason() const = 0;
     virtual QString errorString() const = 0;
 
+    virtual bool synthesizeBatch(const QStringList &texts);
+    virtual void prepare(const QStringList &texts);
+    virtual QList<QVoice> allVoices() const;
+
 protected:
     static QVoice createVoice(const QString &name, const QLocale &locale, QVoice::Gender gender,
                               QVoice::Age age, const QVariant &data);
@@ -71,6 +75,9 @@ Q_SIGNALS:
 
     void sayingWord(const QString &word, qsizetype start, qsizetype length);
     void synthesized(const QAudioFormat &format, const QByteArray &data);
+    void utteranceSynthesized(qsizetype index);
+    void audioWritten(const QAudioFormat &format, qint64 bytes);
+    void voicesChanged();
 };
 
 QT_END_NAMESPACE
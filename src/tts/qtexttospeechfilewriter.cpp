@@ -0,0 +1,219 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechfilewriter_p.h"
+
+#include <QtCore/qdebug.h>
+#include <QtCore/qendian.h>
+
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+template <typename T>
+void appendLittleEndian(QByteArray &bytes, T value)
+{
+    char buffer[sizeof(T)];
+    qToLittleEndian(value, buffer);
+    bytes.append(buffer, sizeof(T));
+}
+
+void appendChunkHeader(QByteArray &bytes, const char (&id)[5], quint32 size)
+{
+    bytes.append(id, 4);
+    appendLittleEndian<quint32>(bytes, size);
+}
+
+quint32 chunkSize(qint64 size)
+{
+    return quint32(qMin(size, qint64(std::numeric_limits<quint32>::max())));
+}
+}
+
+QTextToSpeechFileWriter::QTextToSpeechFileWriter(QIODevice *device,
+                                                 QTextToSpeech::FileFormat format)
+    : m_device(device), m_fileFormat(format)
+{
+}
+
+QTextToSpeechFileWriter::QTextToSpeechFileWriter(std::unique_ptr<QFile> &&file,
+                                                 QTextToSpeech::FileFormat format)
+    : m_file(std::move(file)), m_device(m_file.get()), m_fileFormat(format)
+{
+}
+
+QTextToSpeechFileWriter::~QTextToSpeechFileWriter()
+{
+    finish();
+}
+
+// Opens the file, if the writer owns one, and checks that the device is writable
+bool QTextToSpeechFileWriter::open()
+{
+    if (m_file && !m_file->isOpen()
+        && !m_file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "QTextToSpeech::synthesizeToFile: can't open" << m_file->fileName()
+                   << "for writing:" << m_file->errorString();
+        return false;
+    }
+    if (!m_device || !m_device->isWritable()) {
+        qWarning("QTextToSpeech::synthesizeToFile: device is not open for writing");
+        return false;
+    }
+    return true;
+}
+
+bool QTextToSpeechFileWriter::write(const QAudioFormat &format, const QByteArray &data)
+{
+    if (!m_device || m_finished)
+        return false;
+
+    if (!m_format.isValid()) {
+        m_format = format;
+        if (m_fileFormat != QTextToSpeech::FileFormat::Raw && !writeWavHeader())
+            return false;
+    } else if (format != m_format) {
+        qWarning() << "QTextToSpeech: Can't write data with changing audio format" << format;
+        return false;
+    }
+
+    if (m_device->write(data) != data.size())
+        return false;
+    m_dataSize += data.size();
+    return true;
+}
+
+void QTextToSpeechFileWriter::addCuePoint(const QString &word)
+{
+    if (m_fileFormat != QTextToSpeech::FileFormat::WavWithCuePoints)
+        return;
+    const quint32 sampleOffset = m_format.isValid() ? quint32(m_format.framesForBytes(m_dataSize))
+                                                    : 0;
+    m_cuePoints.append({sampleOffset, word.toUtf8()});
+}
+
+void QTextToSpeechFileWriter::finish()
+{
+    if (m_finished)
+        return;
+    m_finished = true;
+    if (!m_device)
+        return;
+
+    if (m_device->isSequential()) {
+        // Readers take everything after the data chunk's header as data, as its
+        // size is left at the maximum, so nothing can follow the data.
+        if (!m_cuePoints.isEmpty()) {
+            qWarning("QTextToSpeech::synthesizeToFile: can't write cue points to a "
+                     "sequential device");
+        }
+    } else if (m_fileFormat != QTextToSpeech::FileFormat::Raw && m_format.isValid()) {
+        // the data chunk has to be padded to an even size
+        if (m_dataSize % 2)
+            m_device->write("", 1);
+        writeCuePoints();
+
+        // now that the sizes are known, update the header
+        const qint64 end = m_device->pos();
+        const auto writeSize = [this](qint64 pos, qint64 value) {
+            QByteArray size;
+            appendLittleEndian<quint32>(size, chunkSize(value));
+            return m_device->seek(m_headerPos + pos) && m_device->write(size) == size.size();
+        };
+        if (writeSize(4, end - m_headerPos - 8)) {
+            if (m_format.sampleFormat() == QAudioFormat::Float)
+                writeSize(m_headerSize - 12, m_format.framesForBytes(m_dataSize));
+            writeSize(m_headerSize - 4, m_dataSize);
+            m_device->seek(end);
+        }
+    }
+
+    if (m_file)
+        m_file->close();
+}
+
+bool QTextToSpeechFileWriter::writeWavHeader()
+{
+    quint16 formatTag = 1; // WAVE_FORMAT_PCM
+    switch (m_format.sampleFormat()) {
+    case QAudioFormat::UInt8:
+    case QAudioFormat::Int16:
+    case QAudioFormat::Int32:
+        break;
+    case QAudioFormat::Float:
+        formatTag = 3; // WAVE_FORMAT_IEEE_FLOAT
+        break;
+    default:
+        qWarning() << "QTextToSpeech: Can't write audio format" << m_format << "to WAV file";
+        return false;
+    }
+
+    // Sizes are not known yet; for sequential devices, we leave them at the
+    // maximum, which tells readers to read until the end of the stream.
+    constexpr quint32 unknownSize = std::numeric_limits<quint32>::max();
+    // Formats other than PCM have an extension size in the fmt chunk, and
+    // a fact chunk with the number of frames, which precedes the data chunk.
+    const bool isPcm = formatTag == 1;
+    QByteArray header;
+    appendChunkHeader(header, "RIFF", unknownSize);
+    header.append("WAVE", 4);
+    appendChunkHeader(header, "fmt ", isPcm ? 16 : 18);
+    appendLittleEndian<quint16>(header, formatTag);
+    appendLittleEndian<quint16>(header, quint16(m_format.channelCount()));
+    appendLittleEndian<quint32>(header, quint32(m_format.sampleRate()));
+    appendLittleEndian<quint32>(header, quint32(m_format.bytesForFrames(m_format.sampleRate())));
+    appendLittleEndian<quint16>(header, quint16(m_format.bytesPerFrame()));
+    appendLittleEndian<quint16>(header, quint16(m_format.bytesPerSample() * 8));
+    if (!isPcm) {
+        appendLittleEndian<quint16>(header, 0); // cbSize
+        appendChunkHeader(header, "fact", 4);
+        appendLittleEndian<quint32>(header, unknownSize);
+    }
+    appendChunkHeader(header, "data", unknownSize);
+
+    m_headerPos = m_device->isSequential() ? 0 : m_device->pos();
+    m_headerSize = header.size();
+    return m_device->write(header) == header.size();
+}
+
+// Writes a cue chunk with a cue point for each word, and a list chunk with
+// the words as labels for the cue points.
+void QTextToSpeechFileWriter::writeCuePoints()
+{
+    if (m_cuePoints.isEmpty())
+        return;
+
+    QByteArray cues;
+    appendChunkHeader(cues, "cue ", quint32(4 + 24 * m_cuePoints.size()));
+    appendLittleEndian<quint32>(cues, quint32(m_cuePoints.size()));
+    QByteArray labels;
+    labels.append("adtl", 4);
+    for (qsizetype i = 0; i < m_cuePoints.size(); ++i) {
+        const CuePoint &cuePoint = m_cuePoints.at(i);
+        const quint32 id = quint32(i + 1);
+        appendLittleEndian<quint32>(cues, id);
+        appendLittleEndian<quint32>(cues, cuePoint.sampleOffset); // position
+        cues.append("data", 4);
+        appendLittleEndian<quint32>(cues, 0); // chunk start
+        appendLittleEndian<quint32>(cues, 0); // block start
+        appendLittleEndian<quint32>(cues, cuePoint.sampleOffset);
+
+        const quint32 labelSize = quint32(4 + cuePoint.label.size() + 1);
+        appendChunkHeader(labels, "labl", labelSize);
+        appendLittleEndian<quint32>(labels, id);
+        labels.append(cuePoint.label);
+        labels.append('\0');
+        if (labelSize % 2)
+            labels.append('\0');
+    }
+
+    QByteArray list;
+    appendChunkHeader(list, "LIST", quint32(labels.size()));
+    list.append(labels);
+
+    m_device->write(cues);
+    m_device->write(list);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,65 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHFILEWRITER_P_H
+#define QTEXTTOSPEECHFILEWRITER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeech.h>
+
+#include <QtCore/qfile.h>
+#include <QtCore/qpointer.h>
+#include <QtMultimedia/qaudioformat.h>
+
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+// Writes synthesized PCM data to a device as it arrives, optionally wrapped
+// into a WAV container that gets finalized once all data has been written.
+class Q_TEXTTOSPEECH_EXPORT QTextToSpeechFileWriter
+{
+public:
+    QTextToSpeechFileWriter(QIODevice *device, QTextToSpeech::FileFormat format);
+    QTextToSpeechFileWriter(std::unique_ptr<QFile> &&file, QTextToSpeech::FileFormat format);
+    ~QTextToSpeechFileWriter();
+
+    bool open();
+    bool write(const QAudioFormat &format, const QByteArray &data);
+    void addCuePoint(const QString &word);
+    void finish();
+
+private:
+    bool writeWavHeader();
+    void writeCuePoints();
+
+    struct CuePoint
+    {
+        quint32 sampleOffset;
+        QByteArray label;
+    };
+
+    std::unique_ptr<QFile> m_file;
+    QPointer<QIODevice> m_device;
+    const QTextToSpeech::FileFormat m_fileFormat;
+    QAudioFormat m_format;
+    qint64 m_headerPos = 0;
+    qint64 m_headerSize = 0;
+    qint64 m_dataSize = 0;
+    QList<CuePoint> m_cuePoints;
+    bool m_finished = false;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,247 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechpluginindex_p.h"
+#include "qtexttospeechplugin.h"
+
+#include <QtCore/qcborvalue.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qdebug.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qjsonobject.h>
+#include <QtCore/qlibrary.h>
+#include <QtCore/qpluginloader.h>
+#include <QtCore/qsavefile.h>
+#include <QtCore/qstandardpaths.h>
+#include <QtCore/qsysinfo.h>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Qt::StringLiterals;
+
+namespace {
+constexpr quint32 IndexFileMagic = 0x51545350; // "QTSP"
+constexpr quint16 IndexFileVersion = 1;
+constexpr QLatin1StringView IndexFileSuffix = ".ttsplugins"_L1;
+constexpr QLatin1StringView PluginDirectory = "/texttospeech"_L1;
+
+QString pluginIid()
+{
+    return QString::fromLatin1(qobject_interface_iid<QTextToSpeechPlugin *>());
+}
+
+// The checks that QFactoryLoader applies before it offers a plugin: the plugin has
+// to be built against the same major, and an older or the same minor Qt version,
+// and on Windows, debug and release builds can't be mixed.
+bool isCompatiblePlugin(const QJsonObject &metaData)
+{
+    const int qtVersion = metaData.value("version"_L1).toInt();
+    if ((qtVersion & 0x00ff00) > (QT_VERSION & 0x00ff00)
+        || (qtVersion & 0xff0000) != (QT_VERSION & 0xff0000)) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+# ifdef QT_NO_DEBUG
+    constexpr bool isDebug = false;
+# else
+    constexpr bool isDebug = true;
+# endif
+    if (metaData.value("debug"_L1).toBool() != isDebug)
+        return false;
+#endif
+    return true;
+}
+}
+
+/*
+    QTextToSpeechPluginIndex discovers the text-to-speech plugins without
+    loading them. Reading the meta data of the plugins requires opening every
+    library in the plugin directories, so the result is stored in a file in
+    the cache location, and used as long as the modification times of the
+    plugin directories don't change. Setting the environment variable
+    QT_TEXTTOSPEECH_DISABLE_PLUGIN_CACHE disables that file.
+
+    Static plugins are always read from the application.
+*/
+void QTextToSpeechPluginIndex::load()
+{
+    const QList<DirectoryStamp> stamps = directoryStamps();
+    const bool useCache = !qEnvironmentVariableIsSet("QT_TEXTTOSPEECH_DISABLE_PLUGIN_CACHE");
+    const QString fileName = useCache ? cacheFileName(stamps) : QString();
+
+    std::optional<QList<Plugin>> plugins;
+    if (!fileName.isEmpty())
+        plugins = readCache(fileName, stamps);
+    if (!plugins) {
+        plugins = scanDirectories(stamps);
+        if (!fileName.isEmpty())
+            writeCache(fileName, stamps, *plugins);
+    }
+
+    m_plugins = std::move(*plugins);
+    m_plugins << staticPlugins();
+}
+
+QTextToSpeechPlugin *QTextToSpeechPluginIndex::instance(qsizetype index) const
+{
+    if (index < 0 || index >= m_plugins.size())
+        return nullptr;
+
+    const Plugin &plugin = m_plugins.at(index);
+    QObject *object = nullptr;
+    if (plugin.fileName.isEmpty()) {
+        const QList<QStaticPlugin> staticPlugins = QPluginLoader::staticPlugins();
+        if (plugin.staticIndex < staticPlugins.size())
+            object = staticPlugins.at(plugin.staticIndex).instance();
+    } else {
+        // the library stays loaded when the loader gets destroyed
+        QPluginLoader loader(plugin.fileName);
+        object = loader.instance();
+        if (!object)
+            qWarning() << "Error loading text-to-speech plug-in:" << loader.errorString();
+    }
+    return qobject_cast<QTextToSpeechPlugin *>(object);
+}
+
+QList<QTextToSpeechPluginIndex::DirectoryStamp> QTextToSpeechPluginIndex::directoryStamps()
+{
+    QList<DirectoryStamp> stamps;
+    const QStringList libraryPaths = QCoreApplication::libraryPaths();
+    for (const QString &libraryPath : libraryPaths) {
+        const QFileInfo info(libraryPath + PluginDirectory);
+        stamps.append({info.absoluteFilePath(),
+                       info.isDir() ? info.lastModified().toMSecsSinceEpoch() : -1});
+    }
+    return stamps;
+}
+
+// The name of the file depends on the plugin directories, so that applications
+// with different library paths don't overwrite each other's index.
+QString QTextToSpeechPluginIndex::cacheFileName(const QList<DirectoryStamp> &stamps)
+{
+    const QString cacheLocation =
+            QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cacheLocation.isEmpty())
+        return {};
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArrayView(QT_VERSION_STR));
+    hash.addData(QSysInfo::buildAbi().toUtf8());
+    for (const DirectoryStamp &stamp : stamps)
+        hash.addData(stamp.path.toUtf8());
+    return QDir(cacheLocation).filePath("qttexttospeech/"_L1
+                                        + QString::fromLatin1(hash.result().toHex())
+                                        + IndexFileSuffix);
+}
+
+std::optional<QList<QTextToSpeechPluginIndex::Plugin>>
+QTextToSpeechPluginIndex::readCache(const QString &fileName, const QList<DirectoryStamp> &stamps)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return std::nullopt;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != IndexFileMagic || version != IndexFileVersion)
+        return std::nullopt;
+
+    qint64 stampCount = 0;
+    stream >> stampCount;
+    if (stampCount != stamps.size())
+        return std::nullopt;
+    for (const DirectoryStamp &stamp : stamps) {
+        DirectoryStamp cachedStamp;
+        stream >> cachedStamp.path >> cachedStamp.lastModified;
+        if (!(cachedStamp == stamp))
+            return std::nullopt;
+    }
+
+    QList<Plugin> plugins;
+    qint64 pluginCount = 0;
+    stream >> pluginCount;
+    for (qint64 i = 0; i < pluginCount && stream.status() == QDataStream::Ok; ++i) {
+        Plugin plugin;
+        QByteArray metaData;
+        stream >> plugin.fileName >> metaData;
+        plugin.metaData = QCborValue::fromCbor(metaData).toMap();
+        plugins.append(plugin);
+    }
+
+    if (stream.status() != QDataStream::Ok)
+        return std::nullopt;
+    return plugins;
+}
+
+void QTextToSpeechPluginIndex::writeCache(const QString &fileName,
+                                          const QList<DirectoryStamp> &stamps,
+                                          const QList<Plugin> &plugins)
+{
+    if (!QDir().mkpath(QFileInfo(fileName).absolutePath()))
+        return;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << IndexFileMagic << IndexFileVersion << qint64(stamps.size());
+    for (const DirectoryStamp &stamp : stamps)
+        stream << stamp.path << stamp.lastModified;
+    stream << qint64(plugins.size());
+    for (const Plugin &plugin : plugins)
+        stream << plugin.fileName << QCborValue(plugin.metaData).toCbor();
+
+    if (stream.status() == QDataStream::Ok)
+        file.commit();
+}
+
+// Reads the meta data of the libraries without loading them
+QList<QTextToSpeechPluginIndex::Plugin>
+QTextToSpeechPluginIndex::scanDirectories(const QList<DirectoryStamp> &stamps)
+{
+    const QString iid = pluginIid();
+    QList<Plugin> plugins;
+    for (const DirectoryStamp &stamp : stamps) {
+        if (stamp.lastModified < 0)
+            continue;
+        const QFileInfoList files = QDir(stamp.path).entryInfoList(QDir::Files, QDir::Name);
+        for (const QFileInfo &file : files) {
+            if (!QLibrary::isLibrary(file.fileName()))
+                continue;
+            const QPluginLoader loader(file.absoluteFilePath());
+            const QJsonObject metaData = loader.metaData();
+            if (metaData.value("IID"_L1).toString() != iid || !isCompatiblePlugin(metaData))
+                continue;
+            plugins.append({file.absoluteFilePath(), -1,
+                            QCborMap::fromJsonObject(metaData.value("MetaData"_L1).toObject())});
+        }
+    }
+    return plugins;
+}
+
+QList<QTextToSpeechPluginIndex::Plugin> QTextToSpeechPluginIndex::staticPlugins()
+{
+    const QString iid = pluginIid();
+    QList<Plugin> plugins;
+    const QList<QStaticPlugin> staticPlugins = QPluginLoader::staticPlugins();
+    for (qsizetype i = 0; i < staticPlugins.size(); ++i) {
+        const QJsonObject metaData = staticPlugins.at(i).metaData();
+        if (metaData.value("IID"_L1).toString() != iid)
+            continue;
+        plugins.append({QString(), i,
+                        QCborMap::fromJsonObject(metaData.value("MetaData"_L1).toObject())});
+    }
+    return plugins;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,70 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHPLUGININDEX_P_H
+#define QTEXTTOSPEECHPLUGININDEX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeech_global.h>
+
+#include <QtCore/qcbormap.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+
+#include <optional>
+
+QT_BEGIN_NAMESPACE
+
+class QTextToSpeechPlugin;
+
+class QTextToSpeechPluginIndex
+{
+public:
+    struct Plugin
+    {
+        QString fileName; // empty for static plugins
+        qsizetype staticIndex = -1;
+        QCborMap metaData;
+    };
+
+    void load();
+    const QList<Plugin> &plugins() const { return m_plugins; }
+    QTextToSpeechPlugin *instance(qsizetype index) const;
+
+private:
+    struct DirectoryStamp
+    {
+        QString path;
+        qint64 lastModified;
+
+        friend bool operator==(const DirectoryStamp &lhs, const DirectoryStamp &rhs)
+        {
+            return lhs.path == rhs.path && lhs.lastModified == rhs.lastModified;
+        }
+    };
+
+    static QList<DirectoryStamp> directoryStamps();
+    static QString cacheFileName(const QList<DirectoryStamp> &stamps);
+    static std::optional<QList<Plugin>> readCache(const QString &fileName,
+                                                  const QList<DirectoryStamp> &stamps);
+    static void writeCache(const QString &fileName, const QList<DirectoryStamp> &stamps,
+                           const QList<Plugin> &plugins);
+    static QList<Plugin> scanDirectories(const QList<DirectoryStamp> &stamps);
+    static QList<Plugin> staticPlugins();
+
+    QList<Plugin> m_plugins;
+};
+
+QT_END_NAMESPACE
+
+#endif
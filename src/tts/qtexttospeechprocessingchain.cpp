@@ -0,0 +1,313 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechprocessingchain.h"
+
+#include <QtCore/qlist.h>
+#include <QtCore/private/qsimd_p.h>
+
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+class QTextToSpeechProcessingChainPrivate : public QSharedData
+{
+public:
+    QList<QTextToSpeechProcessingChain::Node> nodes;
+};
+
+QT_DEFINE_QSDP_SPECIALIZATION_DTOR(QTextToSpeechProcessingChainPrivate)
+
+namespace {
+using Chunk = QTextToSpeechProcessingChain::Chunk;
+
+// Limits the amplification of quiet texts by normalize()
+constexpr float MaxNormalizeGain = 4.0f;
+
+// The largest absolute sample value, relative to full scale
+float peakLevel(const Chunk &chunk)
+{
+    switch (chunk.format.sampleFormat()) {
+    case QAudioFormat::Int16: {
+        const qint16 *samples = reinterpret_cast<const qint16 *>(chunk.data);
+        const qsizetype count = chunk.size / qsizetype(sizeof(qint16));
+        qsizetype i = 0;
+        int peak = 0;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i max = zero;
+        for (; i + 8 <= count; i += 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+            // saturating, so that -32768 becomes 32767
+            max = _mm_max_epi16(max, _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+        }
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 8));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 4));
+        max = _mm_max_epi16(max, _mm_srli_si128(max, 2));
+        peak = qint16(_mm_cvtsi128_si32(max));
+#endif
+        for (; i < count; ++i)
+            peak = qMax(peak, qAbs(int(samples[i])));
+        return peak / 32768.f;
+    }
+    case QAudioFormat::Float: {
+        const float *samples = reinterpret_cast<const float *>(chunk.data);
+        const qsizetype count = chunk.size / qsizetype(sizeof(float));
+        float peak = 0;
+        for (qsizetype i = 0; i < count; ++i)
+            peak = qMax(peak, std::abs(samples[i]));
+        return peak;
+    }
+    default:
+        return 0;
+    }
+}
+
+void applyGain(Chunk &chunk, float factor)
+{
+    switch (chunk.format.sampleFormat()) {
+    case QAudioFormat::Int16: {
+        qint16 *samples = reinterpret_cast<qint16 *>(chunk.data);
+        const qsizetype count = chunk.size / qsizetype(sizeof(qint16));
+        qsizetype i = 0;
+#if defined(__SSE2__)
+        const __m128 f = _mm_set1_ps(factor);
+        for (; i + 8 <= count; i += 8) {
+            __m128i *p = reinterpret_cast<__m128i *>(samples + i);
+            const __m128i v = _mm_loadu_si128(p);
+            // sign-extend to 32 bit, scale as float, and pack with saturation
+            const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            const __m128i scaledLow = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(low), f));
+            const __m128i scaledHigh = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(high), f));
+            _mm_storeu_si128(p, _mm_packs_epi32(scaledLow, scaledHigh));
+        }
+#endif
+        for (; i < count; ++i)
+            samples[i] = qint16(qBound(-32768, qRound(samples[i] * factor), 32767));
+        break;
+    }
+    case QAudioFormat::Float: {
+        float *samples = reinterpret_cast<float *>(chunk.data);
+        const qsizetype count = chunk.size / qsizetype(sizeof(float));
+        for (qsizetype i = 0; i < count; ++i)
+            samples[i] *= factor;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool isSilentFrame(const Chunk &chunk, qsizetype frame, float threshold)
+{
+    const int channelCount = chunk.format.channelCount();
+    const char *data = chunk.data + frame * chunk.format.bytesPerFrame();
+    for (int channel = 0; channel < channelCount; ++channel) {
+        float value = 0;
+        if (chunk.format.sampleFormat() == QAudioFormat::Int16)
+            value = reinterpret_cast<const qint16 *>(data)[channel] / 32768.f;
+        else
+            value = reinterpret_cast<const float *>(data)[channel];
+        if (std::abs(value) > threshold)
+            return false;
+    }
+    return true;
+}
+}
+
+/*!
+    \class QTextToSpeechProcessingChain
+    \brief The QTextToSpeechProcessingChain class processes the audio data of
+    an engine before it gets delivered or played.
+    \inmodule QtTextToSpeech
+    \since 6.9
+
+    A processing chain is a list of nodes that get called for each chunk of
+    audio data that the engine produces, in the order in which they were
+    appended. The nodes process the data in place, on the thread that
+    synthesizes the audio, before the engine passes the data to the functor
+    of QTextToSpeech::synthesize(), or to the audio device.
+
+    Pass the chain to the engine through the \c processingChain engine
+    parameter. Engines that support processing chains use a copy of the chain
+    for each text they process at the same time, so nodes that keep state
+    between chunks do not need to be thread-safe, but must reset their state
+    with the first chunk of a text.
+
+    \code
+    QTextToSpeechProcessingChain chain;
+    chain.append(QTextToSpeechProcessingChain::trimSilence(0.01));
+    chain.append(QTextToSpeechProcessingChain::normalize(0.9));
+    QTextToSpeech tts(u"flite"_s, {{u"processingChain"_s, QVariant::fromValue(chain)}});
+    \endcode
+
+    The built-in nodes support 16-bit integer and float samples, and leave
+    data in other formats unchanged.
+
+    \sa {Qt TextToSpeech Engines}
+*/
+
+/*!
+    \class QTextToSpeechProcessingChain::Chunk
+    \inmodule QtTextToSpeech
+    \brief A chunk of audio data that the nodes of a QTextToSpeechProcessingChain
+    process.
+
+    \c format is the format of the data. The \c size bytes starting at \c data
+    can be modified in place. A node can drop data from the beginning or the
+    end of the chunk by advancing \c data or by reducing \c size, in whole
+    frames. Nodes get called for chunks from which a previous node dropped all
+    data, so that they see the first and the last chunk of each text. \c first
+    is \c true for the first chunk of a text, and \c last is \c true for the
+    last one.
+*/
+
+/*!
+    \typealias QTextToSpeechProcessingChain::Node
+
+    A function that processes a Chunk in place.
+*/
+
+/*!
+    Constructs an empty QTextToSpeechProcessingChain.
+*/
+QTextToSpeechProcessingChain::QTextToSpeechProcessingChain()
+    : d(new QTextToSpeechProcessingChainPrivate)
+{
+}
+
+/*!
+    Copy-constructs a QTextToSpeechProcessingChain object from \a other.
+
+    The nodes get copied once either of the chains processes data.
+*/
+QTextToSpeechProcessingChain::QTextToSpeechProcessingChain(const QTextToSpeechProcessingChain &other) noexcept
+    : d(other.d)
+{}
+
+/*!
+    Destroys the QTextToSpeechProcessingChain object.
+*/
+QTextToSpeechProcessingChain::~QTextToSpeechProcessingChain()
+{}
+
+/*!
+    \fn QTextToSpeechProcessingChain::QTextToSpeechProcessingChain(QTextToSpeechProcessingChain &&other)
+
+    Moves \a other into this QTextToSpeechProcessingChain object.
+*/
+
+/*!
+    Assigns \a other to this QTextToSpeechProcessingChain object.
+*/
+QTextToSpeechProcessingChain &QTextToSpeechProcessingChain::operator=(const QTextToSpeechProcessingChain &other) noexcept
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    \fn QTextToSpeechProcessingChain &QTextToSpeechProcessingChain::operator=(QTextToSpeechProcessingChain &&other)
+
+    Moves \a other into this QTextToSpeechProcessingChain object.
+*/
+
+/*!
+    \fn void QTextToSpeechProcessingChain::swap(QTextToSpeechProcessingChain &other)
+
+    Swaps \a other with this QTextToSpeechProcessingChain object. This
+    operation is very fast and never fails.
+*/
+
+/*!
+    Appends \a node to the end of the chain.
+*/
+void QTextToSpeechProcessingChain::append(const Node &node)
+{
+    if (node)
+        d->nodes.append(node);
+}
+
+/*!
+    Returns \c true if the chain has no nodes.
+*/
+bool QTextToSpeechProcessingChain::isEmpty() const
+{
+    return d->nodes.isEmpty();
+}
+
+/*!
+    Passes \a chunk through all nodes of the chain, in order.
+*/
+void QTextToSpeechProcessingChain::process(Chunk &chunk)
+{
+    for (Node &node : d->nodes)
+        node(chunk);
+}
+
+/*!
+    Returns a node that multiplies all samples by \a factor.
+*/
+QTextToSpeechProcessingChain::Node QTextToSpeechProcessingChain::gain(double factor)
+{
+    return [factor = float(factor)](Chunk &chunk) {
+        if (factor != 1.0f)
+            applyGain(chunk, factor);
+    };
+}
+
+/*!
+    Returns a node that drops the silence at the beginning and at the end of
+    each text. Frames in which no sample exceeds \a threshold, relative to full
+    scale, are silent. Silence at the end of a text is only dropped from the
+    last chunk of the text.
+*/
+QTextToSpeechProcessingChain::Node QTextToSpeechProcessingChain::trimSilence(double threshold)
+{
+    return [threshold = float(threshold), trimming = true](Chunk &chunk) mutable {
+        const QAudioFormat::SampleFormat sampleFormat = chunk.format.sampleFormat();
+        if (sampleFormat != QAudioFormat::Int16 && sampleFormat != QAudioFormat::Float)
+            return;
+        if (chunk.first)
+            trimming = true;
+
+        const qsizetype bytesPerFrame = chunk.format.bytesPerFrame();
+        qsizetype frames = chunk.size / bytesPerFrame;
+        if (trimming) {
+            qsizetype start = 0;
+            while (start < frames && isSilentFrame(chunk, start, threshold))
+                ++start;
+            trimming = start == frames;
+            chunk.data += start * bytesPerFrame;
+            frames -= start;
+        }
+        if (chunk.last) {
+            while (frames > 0 && isSilentFrame(chunk, frames - 1, threshold))
+                --frames;
+        }
+        chunk.size = frames * bytesPerFrame;
+    };
+}
+
+/*!
+    Returns a node that scales each text so that its loudest sample reaches
+    \a peak, relative to full scale. As the data is processed while it is
+    produced, the gain is based on the loudest sample so far, and only ever
+    decreases during a text. Quiet texts are amplified by a factor of
+    at most 4.
+*/
+QTextToSpeechProcessingChain::Node QTextToSpeechProcessingChain::normalize(double peak)
+{
+    return [target = float(peak), loudest = 0.0f](Chunk &chunk) mutable {
+        if (chunk.first)
+            loudest = 0;
+        loudest = qMax(loudest, peakLevel(chunk));
+        const float factor = loudest > 0 ? qMin(target / loudest, MaxNormalizeGain)
+                                         : MaxNormalizeGain;
+        if (factor != 1.0f)
+            applyGain(chunk, factor);
+    };
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,61 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHPROCESSINGCHAIN_H
+#define QTEXTTOSPEECHPROCESSINGCHAIN_H
+
+#include <QtTextToSpeech/qtexttospeech_global.h>
+#include <QtCore/qshareddata.h>
+#include <QtCore/qmetatype.h>
+#include <QtMultimedia/qaudioformat.h>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+class QTextToSpeechProcessingChainPrivate;
+
+QT_DECLARE_QSDP_SPECIALIZATION_DTOR_WITH_EXPORT(QTextToSpeechProcessingChainPrivate, Q_TEXTTOSPEECH_EXPORT)
+
+class Q_TEXTTOSPEECH_EXPORT QTextToSpeechProcessingChain
+{
+public:
+    struct Chunk
+    {
+        QAudioFormat format;
+        char *data = nullptr;
+        qsizetype size = 0;
+        bool first = false;
+        bool last = false;
+    };
+    using Node = std::function<void(Chunk &chunk)>;
+
+    QTextToSpeechProcessingChain();
+    ~QTextToSpeechProcessingChain();
+    QTextToSpeechProcessingChain(const QTextToSpeechProcessingChain &other) noexcept;
+    QTextToSpeechProcessingChain &operator=(const QTextToSpeechProcessingChain &other) noexcept;
+    QTextToSpeechProcessingChain(QTextToSpeechProcessingChain &&other) noexcept = default;
+    QT_MOVE_ASSIGNMENT_OPERATOR_IMPL_VIA_PURE_SWAP(QTextToSpeechProcessingChain)
+
+    void swap(QTextToSpeechProcessingChain &other) noexcept
+    { d.swap(other.d); }
+
+    void append(const Node &node);
+    bool isEmpty() const;
+    void process(Chunk &chunk);
+
+    static Node gain(double factor);
+    static Node trimSilence(double threshold);
+    static Node normalize(double peak);
+
+private:
+    QSharedDataPointer<QTextToSpeechProcessingChainPrivate> d;
+};
+
+Q_DECLARE_SHARED(QTextToSpeechProcessingChain)
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QTextToSpeechProcessingChain)
+
+#endif
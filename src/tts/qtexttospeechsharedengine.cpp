@@ -0,0 +1,531 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechsharedengine_p.h"
+#include "qtexttospeechplugin.h"
+
+#include <QtCore/qmutex.h>
+#include <QtCore/qthread.h>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Qt::StringLiterals;
+
+namespace {
+// The shared engines of all threads; each engine is only used by its own thread
+struct SharedEngineList
+{
+    QMutex mutex;
+    QList<QTextToSpeechSharedEngine *> engines;
+};
+Q_GLOBAL_STATIC(SharedEngineList, sharedEngines)
+
+// The parameters that don't affect the engine don't prevent sharing it
+QVariantMap engineParameters(const QVariantMap &parameters)
+{
+    QVariantMap result = parameters;
+    result.remove("sharedEngine"_L1);
+    result.remove("initializeAsynchronously"_L1);
+    return result;
+}
+}
+
+/*
+    Returns a new client of the shared engine of the current thread with the
+    provider and parameters, creating that engine through the plugin if there
+    is none yet. The shared engine gets destroyed with its last client.
+*/
+QTextToSpeechEngine *QTextToSpeechSharedEngine::createClient(QTextToSpeechPlugin *plugin,
+                                                             const QString &provider,
+                                                             const QVariantMap &parameters,
+                                                             QString *errorString)
+{
+    const QVariantMap sharedParameters = engineParameters(parameters);
+    QTextToSpeechSharedEngine *shared = nullptr;
+    {
+        QMutexLocker locker(&sharedEngines->mutex);
+        for (QTextToSpeechSharedEngine *engine : std::as_const(sharedEngines->engines)) {
+            if (engine->thread() == QThread::currentThread() && engine->m_provider == provider
+                && engine->m_parameters == sharedParameters) {
+                shared = engine;
+                break;
+            }
+        }
+    }
+
+    if (!shared) {
+        std::unique_ptr<QTextToSpeechEngine> engine(
+                plugin->createTextToSpeechEngine(sharedParameters, nullptr, errorString));
+        if (!engine)
+            return nullptr;
+        shared = new QTextToSpeechSharedEngine(provider, sharedParameters, std::move(engine));
+    }
+    return new QTextToSpeechSharedEngineClient(shared);
+}
+
+QTextToSpeechSharedEngine::QTextToSpeechSharedEngine(const QString &provider,
+                                                     const QVariantMap &parameters,
+                                                     std::unique_ptr<QTextToSpeechEngine> &&engine)
+    : m_provider(provider), m_parameters(parameters), m_engine(std::move(engine))
+{
+    // the engine's attributes change with every client that gets a turn
+    m_defaultLocale = m_engine->locale();
+    m_defaultVoice = m_engine->voice();
+    m_defaultRate = m_engine->rate();
+    m_defaultPitch = m_engine->pitch();
+    m_defaultVolume = m_engine->volume();
+
+    connect(m_engine.get(), &QTextToSpeechEngine::stateChanged,
+            this, &QTextToSpeechSharedEngine::engineStateChanged);
+    connect(m_engine.get(), &QTextToSpeechEngine::errorOccurred,
+            this, &QTextToSpeechSharedEngine::engineErrorOccurred);
+    connect(m_engine.get(), &QTextToSpeechEngine::sayingWord,
+            this, &QTextToSpeechSharedEngine::engineSayingWord);
+    connect(m_engine.get(), &QTextToSpeechEngine::synthesized,
+            this, &QTextToSpeechSharedEngine::engineSynthesized);
+    connect(m_engine.get(), &QTextToSpeechEngine::utteranceSynthesized,
+            this, &QTextToSpeechSharedEngine::engineUtteranceSynthesized);
+    connect(m_engine.get(), &QTextToSpeechEngine::audioWritten,
+            this, &QTextToSpeechSharedEngine::engineAudioWritten);
+    connect(m_engine.get(), &QTextToSpeechEngine::voicesChanged,
+            this, &QTextToSpeechSharedEngine::engineVoicesChanged);
+
+    QMutexLocker locker(&sharedEngines->mutex);
+    sharedEngines->engines.append(this);
+}
+
+QTextToSpeechSharedEngine::~QTextToSpeechSharedEngine()
+{
+    QMutexLocker locker(&sharedEngines->mutex);
+    sharedEngines->engines.removeOne(this);
+}
+
+void QTextToSpeechSharedEngine::removeClient(QTextToSpeechSharedEngineClient *client)
+{
+    const qsizetype index = m_clients.indexOf(client);
+    m_clients.removeAt(index);
+    if (index < m_nextClient)
+        --m_nextClient;
+    if (m_settingsOwner == client)
+        m_settingsOwner = nullptr;
+    if (m_lastActive == client)
+        m_lastActive = nullptr;
+    if (m_preparer == client)
+        m_preparer = nullptr;
+
+    if (m_clients.isEmpty()) {
+        delete this;
+        return;
+    }
+    if (m_active == client) {
+        m_active = nullptr;
+        // engines might report the end of the stopped request later
+        m_stopping = true;
+        m_engine->stop(QTextToSpeech::BoundaryHint::Immediate);
+        const QTextToSpeech::State state = m_engine->state();
+        if (m_stopping && (state == QTextToSpeech::Ready || state == QTextToSpeech::Error)) {
+            m_stopping = false;
+            schedule();
+        }
+    }
+}
+
+// Starts the next waiting request, beginning with the client after the one
+// that had the last turn, so that all clients get their turn.
+void QTextToSpeechSharedEngine::schedule()
+{
+    if (!isIdle())
+        return;
+
+    const qsizetype count = m_clients.size();
+    for (qsizetype i = 0; i < count; ++i) {
+        const qsizetype index = (m_nextClient + i) % count;
+        QTextToSpeechSharedEngineClient *client = m_clients.at(index);
+        if (client->m_request != QTextToSpeechSharedEngineClient::Request::None
+            && client->m_state != QTextToSpeech::Paused) {
+            m_nextClient = (index + 1) % count;
+            start(client);
+            return;
+        }
+    }
+}
+
+void QTextToSpeechSharedEngine::start(QTextToSpeechSharedEngineClient *client)
+{
+    m_active = client;
+    applySettings(client);
+    const auto request = std::exchange(client->m_request,
+                                       QTextToSpeechSharedEngineClient::Request::None);
+    const QString text = std::exchange(client->m_text, {});
+    if (m_preparer != client) {
+        m_preparer = client;
+        m_engine->prepare(client->m_upcomingTexts);
+    }
+    if (request == QTextToSpeechSharedEngineClient::Request::Say)
+        m_engine->say(text);
+    else
+        m_engine->synthesize(text);
+}
+
+// The engine is done with the request of the active client
+void QTextToSpeechSharedEngine::finish(QTextToSpeech::State state)
+{
+    QTextToSpeechSharedEngineClient *client = std::exchange(m_active, nullptr);
+    m_lastActive = client;
+    m_finishing = true;
+    if (state == QTextToSpeech::Error)
+        client->setError(m_engine->errorReason(), m_engine->errorString());
+    else
+        client->setState(state);
+    m_finishing = false;
+    schedule();
+}
+
+void QTextToSpeechSharedEngine::applySettings(QTextToSpeechSharedEngineClient *client)
+{
+    if (m_settingsOwner == client)
+        return;
+    m_settingsOwner = client;
+    if (m_engine->voice() != client->m_voice)
+        m_engine->setVoice(client->m_voice);
+    m_engine->setRate(client->m_rate);
+    m_engine->setPitch(client->m_pitch);
+    m_engine->setVolume(client->m_volume);
+}
+
+QList<QVoice> QTextToSpeechSharedEngine::voicesForLocale(const QLocale &locale) const
+{
+    QList<QVoice> voices = m_engine->allVoices();
+    voices.removeIf([&locale](const QVoice &voice) {
+        return voice.locale() != locale;
+    });
+    return voices;
+}
+
+QTextToSpeechSharedEngineClient *QTextToSpeechSharedEngine::receiver() const
+{
+    return m_active ? m_active : m_lastActive;
+}
+
+void QTextToSpeechSharedEngine::engineStateChanged(QTextToSpeech::State state)
+{
+    if (m_stopping) {
+        if (state == QTextToSpeech::Ready || state == QTextToSpeech::Error) {
+            m_stopping = false;
+            schedule();
+        }
+        return;
+    }
+    if (!m_active)
+        return;
+
+    switch (state) {
+    case QTextToSpeech::Ready:
+    case QTextToSpeech::Error:
+        finish(state);
+        break;
+    default:
+        m_active->setState(state);
+        break;
+    }
+}
+
+void QTextToSpeechSharedEngine::engineErrorOccurred(QTextToSpeech::ErrorReason reason,
+                                                    const QString &errorString)
+{
+    // the error of a request whose client is gone
+    if (m_stopping)
+        return;
+    if (QTextToSpeechSharedEngineClient *client = receiver()) {
+        emit client->errorOccurred(reason, errorString);
+        return;
+    }
+    for (QTextToSpeechSharedEngineClient *client : std::as_const(m_clients))
+        emit client->errorOccurred(reason, errorString);
+}
+
+void QTextToSpeechSharedEngine::engineSayingWord(const QString &word, qsizetype start,
+                                                 qsizetype length)
+{
+    if (m_active)
+        emit m_active->sayingWord(word, start, length);
+}
+
+void QTextToSpeechSharedEngine::engineSynthesized(const QAudioFormat &format,
+                                                  const QByteArray &data)
+{
+    if (m_active)
+        emit m_active->synthesized(format, data);
+}
+
+void QTextToSpeechSharedEngine::engineUtteranceSynthesized(qsizetype index)
+{
+    if (m_active)
+        emit m_active->utteranceSynthesized(index);
+}
+
+void QTextToSpeechSharedEngine::engineAudioWritten(const QAudioFormat &format, qint64 bytes)
+{
+    if (m_active)
+        emit m_active->audioWritten(format, bytes);
+}
+
+void QTextToSpeechSharedEngine::engineVoicesChanged()
+{
+    for (QTextToSpeechSharedEngineClient *client : std::as_const(m_clients))
+        emit client->voicesChanged();
+}
+
+/*
+    QTextToSpeechSharedEngineClient is the engine of a QTextToSpeech object
+    that uses a shared engine. It keeps its own voice attributes, which are set
+    on the shared engine before its requests get processed. While a request
+    waits for its turn, the state is already Speaking or Synthesizing.
+*/
+QTextToSpeechSharedEngineClient::QTextToSpeechSharedEngineClient(QTextToSpeechSharedEngine *shared)
+    : m_shared(shared)
+{
+    QTextToSpeechEngine *engine = m_shared->m_engine.get();
+    if (engine->state() == QTextToSpeech::Error) {
+        m_state = QTextToSpeech::Error;
+        m_errorReason = engine->errorReason();
+        m_errorString = engine->errorString();
+    }
+    m_locale = m_shared->m_defaultLocale;
+    m_voice = m_shared->m_defaultVoice;
+    m_rate = m_shared->m_defaultRate;
+    m_pitch = m_shared->m_defaultPitch;
+    m_volume = m_shared->m_defaultVolume;
+    m_shared->m_clients.append(this);
+}
+
+QTextToSpeechSharedEngineClient::~QTextToSpeechSharedEngineClient()
+{
+    m_shared->removeClient(this);
+}
+
+QTextToSpeech::Capabilities QTextToSpeechSharedEngineClient::capabilities() const
+{
+    return m_shared->m_engine->capabilities();
+}
+
+QList<QLocale> QTextToSpeechSharedEngineClient::availableLocales() const
+{
+    return m_shared->m_engine->availableLocales();
+}
+
+QList<QVoice> QTextToSpeechSharedEngineClient::availableVoices() const
+{
+    return m_shared->voicesForLocale(m_locale);
+}
+
+QList<QVoice> QTextToSpeechSharedEngineClient::allVoices() const
+{
+    return m_shared->m_engine->allVoices();
+}
+
+/*
+    Batches can't wait for their turn, as only the engine knows whether it
+    supports them. They are only passed on if the engine is idle; otherwise,
+    QTextToSpeech synthesizes the texts one after the other.
+*/
+bool QTextToSpeechSharedEngineClient::synthesizeBatch(const QStringList &texts)
+{
+    if (!m_shared->isIdle())
+        return false;
+
+    m_shared->m_active = this;
+    m_shared->applySettings(this);
+    if (!m_shared->m_engine->synthesizeBatch(texts)) {
+        m_shared->m_active = nullptr;
+        return false;
+    }
+    m_errorReason = QTextToSpeech::ErrorReason::NoError;
+    m_errorString.clear();
+    return true;
+}
+
+void QTextToSpeechSharedEngineClient::prepare(const QStringList &texts)
+{
+    m_upcomingTexts = texts;
+    if (m_shared->m_preparer == this)
+        m_shared->m_engine->prepare(texts);
+}
+
+void QTextToSpeechSharedEngineClient::say(const QString &text)
+{
+    request(Request::Say, text);
+}
+
+void QTextToSpeechSharedEngineClient::synthesize(const QString &text)
+{
+    request(Request::Synthesize, text);
+}
+
+void QTextToSpeechSharedEngineClient::request(Request request, const QString &text)
+{
+    m_errorReason = QTextToSpeech::ErrorReason::NoError;
+    m_errorString.clear();
+    // the engine stops the current text when it gets a new one
+    if (isActive()) {
+        if (request == Request::Say)
+            m_shared->m_engine->say(text);
+        else
+            m_shared->m_engine->synthesize(text);
+        return;
+    }
+
+    m_request = request;
+    m_text = text;
+    setState(request == Request::Say ? QTextToSpeech::Speaking : QTextToSpeech::Synthesizing);
+    m_shared->schedule();
+}
+
+void QTextToSpeechSharedEngineClient::stop(QTextToSpeech::BoundaryHint boundaryHint)
+{
+    if (isActive()) {
+        m_shared->m_engine->stop(boundaryHint);
+    } else if (m_request != Request::None) {
+        m_request = Request::None;
+        m_text.clear();
+        setState(QTextToSpeech::Ready);
+    }
+}
+
+void QTextToSpeechSharedEngineClient::pause(QTextToSpeech::BoundaryHint boundaryHint)
+{
+    if (isActive())
+        m_shared->m_engine->pause(boundaryHint);
+    else if (m_request != Request::None)
+        setState(QTextToSpeech::Paused);
+}
+
+void QTextToSpeechSharedEngineClient::resume()
+{
+    if (isActive()) {
+        m_shared->m_engine->resume();
+    } else if (m_request != Request::None && m_state == QTextToSpeech::Paused) {
+        setState(m_request == Request::Say ? QTextToSpeech::Speaking
+                                           : QTextToSpeech::Synthesizing);
+        m_shared->schedule();
+    }
+}
+
+double QTextToSpeechSharedEngineClient::rate() const
+{
+    return m_rate;
+}
+
+bool QTextToSpeechSharedEngineClient::setRate(double rate)
+{
+    if (ownsSettings() && !m_shared->m_engine->setRate(rate))
+        return false;
+    m_rate = rate;
+    return true;
+}
+
+double QTextToSpeechSharedEngineClient::pitch() const
+{
+    return m_pitch;
+}
+
+bool QTextToSpeechSharedEngineClient::setPitch(double pitch)
+{
+    if (ownsSettings() && !m_shared->m_engine->setPitch(pitch))
+        return false;
+    m_pitch = pitch;
+    return true;
+}
+
+double QTextToSpeechSharedEngineClient::volume() const
+{
+    return m_volume;
+}
+
+bool QTextToSpeechSharedEngineClient::setVolume(double volume)
+{
+    if (ownsSettings() && !m_shared->m_engine->setVolume(volume))
+        return false;
+    m_volume = volume;
+    return true;
+}
+
+QLocale QTextToSpeechSharedEngineClient::locale() const
+{
+    return m_locale;
+}
+
+bool QTextToSpeechSharedEngineClient::setLocale(const QLocale &locale)
+{
+    QTextToSpeechEngine *engine = m_shared->m_engine.get();
+    if (ownsSettings()) {
+        if (!engine->setLocale(locale))
+            return false;
+        m_locale = engine->locale();
+        m_voice = engine->voice();
+        return true;
+    }
+
+    const QList<QVoice> voices = m_shared->voicesForLocale(locale);
+    if (voices.isEmpty())
+        return false;
+    m_locale = locale;
+    m_voice = voices.first();
+    return true;
+}
+
+QVoice QTextToSpeechSharedEngineClient::voice() const
+{
+    return m_voice;
+}
+
+bool QTextToSpeechSharedEngineClient::setVoice(const QVoice &voice)
+{
+    QTextToSpeechEngine *engine = m_shared->m_engine.get();
+    if (ownsSettings()) {
+        if (!engine->setVoice(voice))
+            return false;
+        m_locale = engine->locale();
+        m_voice = engine->voice();
+        return true;
+    }
+
+    if (!engine->allVoices().contains(voice))
+        return false;
+    m_locale = voice.locale();
+    m_voice = voice;
+    return true;
+}
+
+QTextToSpeech::State QTextToSpeechSharedEngineClient::state() const
+{
+    return m_state;
+}
+
+QTextToSpeech::ErrorReason QTextToSpeechSharedEngineClient::errorReason() const
+{
+    return m_errorReason;
+}
+
+QString QTextToSpeechSharedEngineClient::errorString() const
+{
+    return m_errorString;
+}
+
+void QTextToSpeechSharedEngineClient::setState(QTextToSpeech::State state)
+{
+    if (m_state == state)
+        return;
+    m_state = state;
+    emit stateChanged(m_state);
+}
+
+void QTextToSpeechSharedEngineClient::setError(QTextToSpeech::ErrorReason reason,
+                                               const QString &errorString)
+{
+    m_errorReason = reason;
+    m_errorString = errorString;
+    setState(QTextToSpeech::Error);
+}
+
+QT_END_NAMESPACE
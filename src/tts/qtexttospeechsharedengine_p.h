@@ -0,0 +1,165 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHSHAREDENGINE_P_H
+#define QTEXTTOSPEECHSHAREDENGINE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeechengine.h>
+#include <QtTextToSpeech/qvoice.h>
+
+#include <QtCore/qlist.h>
+#include <QtCore/qobject.h>
+#include <QtCore/qvariantmap.h>
+
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QTextToSpeechPlugin;
+class QTextToSpeechSharedEngineClient;
+
+// An engine that all QTextToSpeech objects of a thread with the same engine
+// name and parameters speak through. Each of them has its own client engine,
+// with its own voice attributes. The requests of the clients are processed
+// one at a time, taking turns between the clients that have a request. The
+// engine gets told about the upcoming texts of the client whose request it
+// processes. Batches are only passed to the engine if it is idle.
+class QTextToSpeechSharedEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static QTextToSpeechEngine *createClient(QTextToSpeechPlugin *plugin, const QString &provider,
+                                             const QVariantMap &parameters, QString *errorString);
+    ~QTextToSpeechSharedEngine() override;
+
+private:
+    friend class QTextToSpeechSharedEngineClient;
+
+    QTextToSpeechSharedEngine(const QString &provider, const QVariantMap &parameters,
+                              std::unique_ptr<QTextToSpeechEngine> &&engine);
+
+    void removeClient(QTextToSpeechSharedEngineClient *client);
+    bool isIdle() const { return !m_active && !m_finishing && !m_stopping; }
+    void schedule();
+    void start(QTextToSpeechSharedEngineClient *client);
+    void finish(QTextToSpeech::State state);
+    void applySettings(QTextToSpeechSharedEngineClient *client);
+    QList<QVoice> voicesForLocale(const QLocale &locale) const;
+    QTextToSpeechSharedEngineClient *receiver() const;
+
+    void engineStateChanged(QTextToSpeech::State state);
+    void engineErrorOccurred(QTextToSpeech::ErrorReason reason, const QString &errorString);
+    void engineSayingWord(const QString &word, qsizetype start, qsizetype length);
+    void engineSynthesized(const QAudioFormat &format, const QByteArray &data);
+    void engineUtteranceSynthesized(qsizetype index);
+    void engineAudioWritten(const QAudioFormat &format, qint64 bytes);
+    void engineVoicesChanged();
+
+    const QString m_provider;
+    const QVariantMap m_parameters;
+    std::unique_ptr<QTextToSpeechEngine> m_engine;
+    QList<QTextToSpeechSharedEngineClient *> m_clients;
+    // the client whose request the engine is processing
+    QTextToSpeechSharedEngineClient *m_active = nullptr;
+    // the client that was active last, for errors reported after the state change
+    QTextToSpeechSharedEngineClient *m_lastActive = nullptr;
+    // the client whose voice attributes are set on the engine
+    QTextToSpeechSharedEngineClient *m_settingsOwner = nullptr;
+    // the position in m_clients from where the next request is looked for
+    qsizetype m_nextClient = 0;
+    // requests made while the active client gets notified are not started right away
+    bool m_finishing = false;
+    // the engine stops the request of a removed client; the next request only
+    // starts once the engine reports that, so that it doesn't get credited with it
+    bool m_stopping = false;
+    // the client whose upcoming texts have been passed to the engine's prepare()
+    QTextToSpeechSharedEngineClient *m_preparer = nullptr;
+
+    // the voice attributes of the engine when it was created, which new clients start with
+    QLocale m_defaultLocale;
+    QVoice m_defaultVoice;
+    double m_defaultRate = 0;
+    double m_defaultPitch = 0;
+    double m_defaultVolume = 0;
+};
+
+class QTextToSpeechSharedEngineClient : public QTextToSpeechEngine
+{
+    Q_OBJECT
+
+public:
+    explicit QTextToSpeechSharedEngineClient(QTextToSpeechSharedEngine *shared);
+    ~QTextToSpeechSharedEngineClient() override;
+
+    QTextToSpeech::Capabilities capabilities() const override;
+    QList<QLocale> availableLocales() const override;
+    QList<QVoice> availableVoices() const override;
+    QList<QVoice> allVoices() const override;
+    bool synthesizeBatch(const QStringList &texts) override;
+    void prepare(const QStringList &texts) override;
+    void say(const QString &text) override;
+    void synthesize(const QString &text) override;
+    void stop(QTextToSpeech::BoundaryHint boundaryHint) override;
+    void pause(QTextToSpeech::BoundaryHint boundaryHint) override;
+    void resume() override;
+    double rate() const override;
+    bool setRate(double rate) override;
+    double pitch() const override;
+    bool setPitch(double pitch) override;
+    QLocale locale() const override;
+    bool setLocale(const QLocale &locale) override;
+    double volume() const override;
+    bool setVolume(double volume) override;
+    QVoice voice() const override;
+    bool setVoice(const QVoice &voice) override;
+    QTextToSpeech::State state() const override;
+    QTextToSpeech::ErrorReason errorReason() const override;
+    QString errorString() const override;
+
+private:
+    friend class QTextToSpeechSharedEngine;
+
+    enum class Request {
+        None,
+        Say,
+        Synthesize
+    };
+    void request(Request request, const QString &text);
+    bool isActive() const { return m_shared->m_active == this; }
+    bool ownsSettings() const { return m_shared->m_settingsOwner == this; }
+    void setState(QTextToSpeech::State state);
+    void setError(QTextToSpeech::ErrorReason reason, const QString &errorString);
+
+    QTextToSpeechSharedEngine *m_shared;
+    // the request that waits for its turn
+    Request m_request = Request::None;
+    QString m_text;
+    // the texts that QTextToSpeech will pass to say() next
+    QStringList m_upcomingTexts;
+
+    QTextToSpeech::State m_state = QTextToSpeech::Ready;
+    QTextToSpeech::ErrorReason m_errorReason = QTextToSpeech::ErrorReason::NoError;
+    QString m_errorString;
+
+    QLocale m_locale;
+    QVoice m_voice;
+    double m_rate = 0;
+    double m_pitch = 0;
+    double m_volume = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,170 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechstatistics.h"
+#include "qtexttospeechstatistics_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QT_DEFINE_QSDP_SPECIALIZATION_DTOR(QTextToSpeechStatisticsPrivate)
+
+/*!
+    \class QTextToSpeechStatistics
+    \brief The QTextToSpeechStatistics class holds performance figures for
+    the processing of a single text.
+    \inmodule QtTextToSpeech
+    \since 6.9
+
+    QTextToSpeech reports the statistics for each text through the
+    \l{QTextToSpeech::}{statisticsAvailable()} signal once the engine is
+    done with that text.
+
+    All times are in microseconds, and measured from the moment at which
+    QTextToSpeech passed the text to the engine. For texts that are spoken,
+    the audio data is only known for engines that play the audio themselves.
+
+    \sa QTextToSpeech::statisticsAvailable()
+*/
+
+/*!
+    Constructs an empty QTextToSpeechStatistics object.
+*/
+QTextToSpeechStatistics::QTextToSpeechStatistics()
+    : d(new QTextToSpeechStatisticsPrivate)
+{
+}
+
+/*!
+    Copy-constructs a QTextToSpeechStatistics object from \a other.
+*/
+QTextToSpeechStatistics::QTextToSpeechStatistics(const QTextToSpeechStatistics &other) noexcept
+    : d(other.d)
+{}
+
+/*!
+    Destroys the QTextToSpeechStatistics object.
+*/
+QTextToSpeechStatistics::~QTextToSpeechStatistics()
+{}
+
+/*!
+    \fn QTextToSpeechStatistics::QTextToSpeechStatistics(QTextToSpeechStatistics &&other)
+
+    Moves \a other into this QTextToSpeechStatistics object.
+*/
+
+/*!
+    Assigns \a other to this QTextToSpeechStatistics object.
+*/
+QTextToSpeechStatistics &QTextToSpeechStatistics::operator=(const QTextToSpeechStatistics &other) noexcept
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+    \fn QTextToSpeechStatistics &QTextToSpeechStatistics::operator=(QTextToSpeechStatistics &&other)
+
+    Moves \a other into this QTextToSpeechStatistics object.
+*/
+
+/*!
+    \fn void QTextToSpeechStatistics::swap(QTextToSpeechStatistics &other)
+
+    Swaps \a other with this QTextToSpeechStatistics object. This operation is
+    very fast and never fails.
+*/
+
+/*!
+    \property QTextToSpeechStatistics::id
+    \brief the index of the text in the queue.
+
+    This is the same as the \c id passed to QTextToSpeech::aboutToSynthesize()
+    for the text.
+*/
+qsizetype QTextToSpeechStatistics::id() const
+{
+    return d->id;
+}
+
+/*!
+    \property QTextToSpeechStatistics::firstAudioTime
+    \brief the time until the engine produced the first audio data, or -1 if
+    no audio data is known.
+*/
+qint64 QTextToSpeechStatistics::firstAudioTime() const
+{
+    return d->firstAudioTime;
+}
+
+/*!
+    \property QTextToSpeechStatistics::speakingTime
+    \brief the time until the state changed to \l{QTextToSpeech::}{Speaking},
+    or -1 if the text was not spoken.
+*/
+qint64 QTextToSpeechStatistics::speakingTime() const
+{
+    return d->speakingTime;
+}
+
+/*!
+    \property QTextToSpeechStatistics::synthesisTime
+    \brief the time until the engine produced the last audio data, or -1 if
+    no audio data is known.
+*/
+qint64 QTextToSpeechStatistics::synthesisTime() const
+{
+    return d->synthesisTime;
+}
+
+/*!
+    \property QTextToSpeechStatistics::totalTime
+    \brief the time until the engine was done with the text.
+*/
+qint64 QTextToSpeechStatistics::totalTime() const
+{
+    return d->totalTime;
+}
+
+/*!
+    \property QTextToSpeechStatistics::audioDuration
+    \brief the duration of the audio data that the engine produced.
+*/
+qint64 QTextToSpeechStatistics::audioDuration() const
+{
+    return d->audioDuration;
+}
+
+/*!
+    \property QTextToSpeechStatistics::realTimeFactor
+    \brief the ratio between synthesisTime and audioDuration.
+
+    Values below 1.0 mean that the engine produces audio faster than it
+    plays. The value is 0 if no audio data is known.
+*/
+double QTextToSpeechStatistics::realTimeFactor() const
+{
+    if (d->audioDuration <= 0 || d->synthesisTime < 0)
+        return 0;
+    return double(d->synthesisTime) / double(d->audioDuration);
+}
+
+/*!
+    \property QTextToSpeechStatistics::chunkCount
+    \brief the number of chunks in which the engine produced the audio data.
+*/
+qsizetype QTextToSpeechStatistics::chunkCount() const
+{
+    return d->chunkCount;
+}
+
+/*!
+    \property QTextToSpeechStatistics::byteCount
+    \brief the size of the audio data that the engine produced, in bytes.
+*/
+qint64 QTextToSpeechStatistics::byteCount() const
+{
+    return d->byteCount;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,63 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHSTATISTICS_H
+#define QTEXTTOSPEECHSTATISTICS_H
+
+#include <QtTextToSpeech/qtexttospeech_global.h>
+#include <QtCore/qshareddata.h>
+#include <QtCore/qmetatype.h>
+#include <QtCore/qobjectdefs.h>
+
+QT_BEGIN_NAMESPACE
+
+class QTextToSpeechStatisticsPrivate;
+
+QT_DECLARE_QSDP_SPECIALIZATION_DTOR_WITH_EXPORT(QTextToSpeechStatisticsPrivate, Q_TEXTTOSPEECH_EXPORT)
+
+class Q_TEXTTOSPEECH_EXPORT QTextToSpeechStatistics
+{
+    Q_GADGET
+    Q_PROPERTY(qsizetype id READ id CONSTANT)
+    Q_PROPERTY(qint64 firstAudioTime READ firstAudioTime CONSTANT)
+    Q_PROPERTY(qint64 speakingTime READ speakingTime CONSTANT)
+    Q_PROPERTY(qint64 synthesisTime READ synthesisTime CONSTANT)
+    Q_PROPERTY(qint64 totalTime READ totalTime CONSTANT)
+    Q_PROPERTY(qint64 audioDuration READ audioDuration CONSTANT)
+    Q_PROPERTY(double realTimeFactor READ realTimeFactor CONSTANT)
+    Q_PROPERTY(qsizetype chunkCount READ chunkCount CONSTANT)
+    Q_PROPERTY(qint64 byteCount READ byteCount CONSTANT)
+
+public:
+    QTextToSpeechStatistics();
+    ~QTextToSpeechStatistics();
+    QTextToSpeechStatistics(const QTextToSpeechStatistics &other) noexcept;
+    QTextToSpeechStatistics &operator=(const QTextToSpeechStatistics &other) noexcept;
+    QTextToSpeechStatistics(QTextToSpeechStatistics &&other) noexcept = default;
+    QT_MOVE_ASSIGNMENT_OPERATOR_IMPL_VIA_PURE_SWAP(QTextToSpeechStatistics)
+
+    void swap(QTextToSpeechStatistics &other) noexcept
+    { d.swap(other.d); }
+
+    qsizetype id() const;
+    qint64 firstAudioTime() const;
+    qint64 speakingTime() const;
+    qint64 synthesisTime() const;
+    qint64 totalTime() const;
+    qint64 audioDuration() const;
+    double realTimeFactor() const;
+    qsizetype chunkCount() const;
+    qint64 byteCount() const;
+
+private:
+    QSharedDataPointer<QTextToSpeechStatisticsPrivate> d;
+    friend class QTextToSpeechPrivate;
+};
+
+Q_DECLARE_SHARED(QTextToSpeechStatistics)
+
+QT_END_NAMESPACE
+
+Q_DECLARE_METATYPE(QTextToSpeechStatistics)
+
+#endif
@@ -0,0 +1,40 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHSTATISTICS_P_H
+#define QTEXTTOSPEECHSTATISTICS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeechstatistics.h>
+
+#include <QtCore/qshareddata.h>
+
+QT_BEGIN_NAMESPACE
+
+class QTextToSpeechStatisticsPrivate : public QSharedData
+{
+public:
+    qsizetype id = -1;
+    // all times in microseconds since the text was passed to the engine
+    qint64 firstAudioTime = -1;
+    qint64 speakingTime = -1;
+    qint64 synthesisTime = -1;
+    qint64 totalTime = 0;
+    qint64 audioDuration = 0;
+    qsizetype chunkCount = 0;
+    qint64 byteCount = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
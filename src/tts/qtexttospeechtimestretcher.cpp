@@ -0,0 +1,275 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qtexttospeechtimestretcher_p.h"
+#include "qtexttospeechdsp_p.h"
+
+#include <QtCore/qmath.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+// Length of the frames, and maximum distance of a frame from its nominal
+// position, in milliseconds; the range covers the pitch period of low voices
+constexpr int FrameDuration = 20;
+constexpr int SearchRangeDuration = 10;
+// The coarse search checks positions at about this rate
+constexpr int SearchRate = 8000;
+}
+
+QTextToSpeechTimeStretcher::QTextToSpeechTimeStretcher(const QAudioFormat &format)
+    : m_format(format)
+{
+    if (!format.isValid() || (format.sampleFormat() != QAudioFormat::Int16
+                              && format.sampleFormat() != QAudioFormat::Float)) {
+        return;
+    }
+
+    const int sampleRate = format.sampleRate();
+    m_hop = qMax(sampleRate * FrameDuration / 2000, 1);
+    m_frameLength = 2 * m_hop;
+    m_searchRange = sampleRate * SearchRangeDuration / 1000;
+    m_searchStep = qMax(sampleRate / SearchRate, 1);
+    // periodic, so that the overlapping halves of two frames add up to one
+    m_window.resize(m_frameLength);
+    for (qsizetype n = 0; n < m_frameLength; ++n)
+        m_window[n] = float(0.5 - 0.5 * std::cos(M_PI * n / m_hop));
+
+    m_input.resize(format.channelCount());
+    m_overlap.resize(format.channelCount());
+    m_output.resize(format.channelCount());
+    m_energies.reserve(2 * m_searchRange + 1);
+    m_valid = true;
+    reset();
+}
+
+void QTextToSpeechTimeStretcher::setSpeed(double speed)
+{
+    m_speed = qBound(MinSpeed, speed, MaxSpeed);
+}
+
+void QTextToSpeechTimeStretcher::reset()
+{
+    m_nominalPosition = 0;
+    m_previousPosition = -1;
+    m_inputStart = 0;
+    for (QList<float> &channel : m_input)
+        channel.clear();
+    m_mix.clear();
+    for (QList<float> &channel : m_overlap)
+        channel.fill(0, m_hop);
+}
+
+void QTextToSpeechTimeStretcher::reserve(qsizetype frames)
+{
+    if (!m_valid)
+        return;
+    // the input held back for the next frame, and the padding at the end of the stream
+    const qsizetype input = frames + 2 * (m_frameLength + m_searchRange);
+    const qsizetype output = qsizetype(frames / MinSpeed) + m_hop;
+    for (QList<float> &channel : m_input)
+        channel.reserve(input);
+    if (m_input.size() > 1)
+        m_mix.reserve(input);
+    for (QList<float> &channel : m_output)
+        channel.reserve(output);
+}
+
+qint64 QTextToSpeechTimeStretcher::inputPosition() const
+{
+    return m_previousPosition < 0 ? 0 : m_previousPosition + m_hop;
+}
+
+const QList<float> &QTextToSpeechTimeStretcher::analysisInput() const
+{
+    return m_input.size() > 1 ? m_mix : m_input.first();
+}
+
+void QTextToSpeechTimeStretcher::process(QByteArrayView input, QByteArray &output,
+                                         bool endOfStream)
+{
+    // keeps the capacity of output, unlike clear()
+    output.resize(0);
+    if (!m_valid)
+        return;
+
+    readFrames(input.data(), input.size() / m_format.bytesPerFrame());
+    for (QList<float> &channel : m_output)
+        channel.clear();
+
+    // Silence after the end of the stream completes the last frames
+    const qint64 end = m_inputStart + m_input.first().size();
+    if (endOfStream) {
+        const qsizetype padding = m_frameLength + m_searchRange;
+        for (QList<float> &channel : m_input)
+            channel.resize(channel.size() + padding);
+        if (m_input.size() > 1)
+            m_mix.resize(m_mix.size() + padding);
+    }
+
+    while (!endOfStream || m_previousPosition < 0 || m_previousPosition + m_hop < end) {
+        const qint64 position = nextFramePosition(endOfStream);
+        if (position < 0)
+            break;
+        addFrame(position, endOfStream ? end : -1);
+    }
+
+    // Keep the input that the search range, or the continuation of the
+    // previous frame, of the next frame needs
+    if (m_previousPosition >= 0) {
+        const qint64 keep = qMin(qint64(m_nominalPosition) - m_searchRange,
+                                 m_previousPosition + m_hop);
+        const qsizetype drop = qsizetype(qBound(qint64(0), keep - m_inputStart,
+                                                qint64(m_input.first().size())));
+        for (QList<float> &channel : m_input)
+            channel.remove(0, drop);
+        if (m_input.size() > 1)
+            m_mix.remove(0, drop);
+        m_inputStart += drop;
+    }
+
+    writeFrames(output);
+    if (endOfStream)
+        reset();
+}
+
+// Returns the position of the next frame, or -1 if more input is needed
+qint64 QTextToSpeechTimeStretcher::nextFramePosition(bool endOfStream)
+{
+    const qint64 available = m_inputStart + analysisInput().size();
+    const qint64 nominal = qRound64(m_nominalPosition);
+    if (m_previousPosition < 0)
+        return nominal + m_frameLength <= available ? nominal : -1;
+
+    // The input that follows the previous frame continues it seamlessly
+    const qint64 natural = m_previousPosition + m_hop;
+    const qint64 from = qMax(nominal - m_searchRange, m_inputStart);
+    qint64 to = nominal + m_searchRange;
+    if (!endOfStream && qMax(to, natural) + m_frameLength > available)
+        return -1;
+    to = qMin(to, available - m_frameLength);
+    if (to < from)
+        return natural;
+    if (m_speed == 1 && natural >= from && natural <= to)
+        return natural;
+    return bestFramePosition(from, to, natural);
+}
+
+// Returns the position between from and to at which the first half of a frame
+// is most similar to the continuation of the previous frame, which it overlaps
+qint64 QTextToSpeechTimeStretcher::bestFramePosition(qint64 from, qint64 to, qint64 natural)
+{
+    const float *data = analysisInput().constData();
+    const float *reference = data + (natural - m_inputStart);
+    const float *candidates = data + (from - m_inputStart);
+    const qsizetype count = qsizetype(to - from + 1);
+
+    // The correlation is normalized by the energy of each candidate, which is
+    // updated incrementally from one position to the next
+    m_energies.resize(count);
+    double energy = 0;
+    for (qsizetype n = 0; n < m_hop; ++n)
+        energy += double(candidates[n]) * candidates[n];
+    for (qsizetype i = 0; i < count; ++i) {
+        m_energies[i] = qMax(energy, 1e-9);
+        energy += double(candidates[i + m_hop]) * candidates[i + m_hop]
+                - double(candidates[i]) * candidates[i];
+    }
+    const auto similarity = [&](qsizetype i) {
+        return QTextToSpeechDsp::dotProduct(reference, candidates + i, m_hop) / std::sqrt(m_energies.at(i));
+    };
+
+    qsizetype best = 0;
+    double bestSimilarity = similarity(0);
+    for (qsizetype i = m_searchStep; i < count; i += m_searchStep) {
+        if (const double value = similarity(i); value > bestSimilarity) {
+            best = i;
+            bestSimilarity = value;
+        }
+    }
+    const qsizetype coarse = best;
+    for (qsizetype i = qMax(coarse - m_searchStep + 1, qsizetype(0));
+         i < qMin(coarse + m_searchStep, count); ++i) {
+        if (const double value = similarity(i); value > bestSimilarity) {
+            best = i;
+            bestSimilarity = value;
+        }
+    }
+    return from + best;
+}
+
+// Adds the frame at position to the overlap of the previous frame, and outputs
+// the first half. At the end of the stream, only the data before end is output.
+void QTextToSpeechTimeStretcher::addFrame(qint64 position, qint64 end)
+{
+    const qsizetype offset = qsizetype(position - m_inputStart);
+    const qsizetype count = end < 0 ? m_hop
+                                    : qsizetype(qBound(qint64(0), end - position, qint64(m_hop)));
+    // The first frame continues the data that preceded the stream
+    const bool first = m_previousPosition < 0;
+    const float *window = m_window.constData();
+    for (qsizetype c = 0; c < m_input.size(); ++c) {
+        const float *input = m_input.at(c).constData() + offset;
+        float *overlap = m_overlap[c].data();
+        QList<float> &output = m_output[c];
+        for (qsizetype n = 0; n < count; ++n)
+            output.append(first ? input[n] : overlap[n] + input[n] * window[n]);
+        for (qsizetype n = 0; n < m_hop; ++n)
+            overlap[n] = input[m_hop + n] * window[m_hop + n];
+    }
+    m_previousPosition = position;
+    m_nominalPosition += m_hop * m_speed;
+}
+
+void QTextToSpeechTimeStretcher::readFrames(const char *data, qsizetype frames)
+{
+    const qsizetype channelCount = m_input.size();
+    for (qsizetype c = 0; c < channelCount; ++c) {
+        QList<float> &channel = m_input[c];
+        const qsizetype offset = channel.size();
+        channel.resize(offset + frames);
+        float *out = channel.data() + offset;
+        if (m_format.sampleFormat() == QAudioFormat::Int16) {
+            const qint16 *samples = reinterpret_cast<const qint16 *>(data);
+            for (qsizetype f = 0; f < frames; ++f)
+                out[f] = samples[f * channelCount + c] / 32768.f;
+        } else {
+            const float *samples = reinterpret_cast<const float *>(data);
+            for (qsizetype f = 0; f < frames; ++f)
+                out[f] = samples[f * channelCount + c];
+        }
+    }
+    if (channelCount < 2)
+        return;
+
+    // the mix has as many samples as each channel
+    const qsizetype offset = m_mix.size();
+    m_mix.resize(offset + frames);
+    for (qsizetype f = offset; f < offset + frames; ++f) {
+        float sum = 0;
+        for (qsizetype c = 0; c < channelCount; ++c)
+            sum += m_input.at(c).at(f);
+        m_mix[f] = sum / channelCount;
+    }
+}
+
+void QTextToSpeechTimeStretcher::writeFrames(QByteArray &output)
+{
+    const qsizetype channelCount = m_output.size();
+    const qsizetype frames = m_output.first().size();
+    output.resize(frames * m_format.bytesPerFrame());
+    for (qsizetype c = 0; c < channelCount; ++c) {
+        const float *in = m_output.at(c).constData();
+        if (m_format.sampleFormat() == QAudioFormat::Int16) {
+            qint16 *samples = reinterpret_cast<qint16 *>(output.data());
+            for (qsizetype f = 0; f < frames; ++f)
+                samples[f * channelCount + c] = qint16(qBound(-32768, qRound(in[f] * 32768.f), 32767));
+        } else {
+            float *samples = reinterpret_cast<float *>(output.data());
+            for (qsizetype f = 0; f < frames; ++f)
+                samples[f * channelCount + c] = in[f];
+        }
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,101 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QTEXTTOSPEECHTIMESTRETCHER_P_H
+#define QTEXTTOSPEECHTIMESTRETCHER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtTextToSpeech/qtexttospeech_global.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qbytearrayview.h>
+#include <QtCore/qlist.h>
+#include <QtMultimedia/qaudioformat.h>
+
+QT_BEGIN_NAMESPACE
+
+// Changes the speed of a stream of PCM data without changing its pitch, so that
+// engines can apply a new rate to audio that has already been synthesized. The
+// data is cut into overlapping frames, which are added up again at a different
+// distance (WSOLA). Each frame is taken from the position within a search range
+// around its nominal position that best continues the previous frame. Only
+// 16-bit integer and float samples are supported.
+class Q_TEXTTOSPEECH_EXPORT QTextToSpeechTimeStretcher
+{
+public:
+    static constexpr double MinSpeed = 0.25;
+    static constexpr double MaxSpeed = 4.0;
+
+    explicit QTextToSpeechTimeStretcher(const QAudioFormat &format);
+
+    bool isValid() const { return m_valid; }
+    QAudioFormat format() const { return m_format; }
+
+    // The ratio between the duration of the input and of the output; can be
+    // changed at any time, and applies to the next frame
+    void setSpeed(double speed);
+    double speed() const { return m_speed; }
+
+    // Stretches input, which must consist of whole frames, and replaces the content
+    // of output with the result. The stretcher holds back the input that the next
+    // frames overlap with; with endOfStream, all data is included in output, and
+    // the stretcher is reset for the next stream.
+    void process(QByteArrayView input, QByteArray &output, bool endOfStream = false);
+    void reset();
+    // Allocates the internal buffers for input of up to frames frames per call
+    // to process(), so that processing doesn't allocate memory
+    void reserve(qsizetype frames);
+
+    // The number of input frames that the output produced so far corresponds to
+    qint64 inputPosition() const;
+
+private:
+    void readFrames(const char *data, qsizetype frames);
+    void writeFrames(QByteArray &output);
+    qint64 nextFramePosition(bool endOfStream);
+    qint64 bestFramePosition(qint64 from, qint64 to, qint64 natural);
+    void addFrame(qint64 position, qint64 end);
+    const QList<float> &analysisInput() const;
+
+    QAudioFormat m_format;
+    bool m_valid = false;
+    double m_speed = 1;
+
+    // Frames of m_frameLength samples overlap by half, weighted with a Hann window;
+    // m_searchRange is the maximum distance from the nominal position, and the
+    // search first checks every m_searchStep'th position
+    qsizetype m_frameLength = 0;
+    qsizetype m_hop = 0;
+    qsizetype m_searchRange = 0;
+    qsizetype m_searchStep = 1;
+    QList<float> m_window;
+
+    // Positions in input frames since the last reset: where the next frame would
+    // be taken without searching, and where the previous frame was taken, or -1
+    double m_nominalPosition = 0;
+    qint64 m_previousPosition = -1;
+
+    // per channel, starting at m_inputStart; m_mix is the mono signal that frames
+    // get compared with, if there is more than one channel
+    qint64 m_inputStart = 0;
+    QList<QList<float>> m_input;
+    QList<float> m_mix;
+    // per channel, the second half of the previous frame, already weighted
+    QList<QList<float>> m_overlap;
+    QList<QList<float>> m_output;
+    QList<double> m_energies;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -11,7 +11,14 @@
 #include <QAudioBuffer>
 #include <QOperatingSystemVersion>
 #include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QtEndian>
+#include <QtMath>
 #include <qttexttospeech-config.h>
+#include <QtTextToSpeech/private/qtexttospeechaudioconverter_p.h>
+#include <QtTextToSpeech/private/qtexttospeechfilewriter_p.h>
+#include <QtTextToSpeech/private/qtexttospeechtimestretcher_p.h>
 
 #if QT_CONFIG(speechd)
     #include <libspeechd.h>
@@ -24,6 +31,23 @@ using namespace Qt::StringLiterals;
 
 enum : int { SpeechDuration = 20000 };
 
+// A device that can't seek, like a pipe or a socket
+class SequentialDevice : public QIODevice
+{
+public:
+    bool isSequential() const override { return true; }
+
+    QByteArray written;
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+    qint64 writeData(const char *data, qint64 size) override
+    {
+        written.append(data, size);
+        return size;
+    }
+};
+
 class tst_QTextToSpeech : public QObject
 {
     Q_OBJECT
@@ -38,6 +62,8 @@ private slots:
     void availableLocales();
     void findVoices_data();
     void findVoices();
+    void allVoices();
+    void voicesChanged();
 
     void locale();
     void voice();
@@ -69,6 +95,28 @@ private slots:
     void synthesizeCallback_data();
     void synthesizeCallback();
 
+    void synthesisCache();
+
+    void synthesizeBatch_data();
+    void synthesizeBatch();
+
+    void synthesizeToFile_data();
+    void synthesizeToFile();
+    void synthesizeToFileWithCuePoints();
+    void floatWavFile();
+    void sequentialWavFile();
+
+    void statistics();
+
+    void asynchronousInitialization();
+    void sharedEngine();
+
+    void audioConverter_data();
+    void audioConverter();
+    void processingChain();
+    void timeStretcher_data();
+    void timeStretcher();
+
 public:
     using Selector = QList<QVoice>(*)(const QTextToSpeech *);
     using VoiceData = typename std::tuple<QString, QLocale, QVoice::Gender, QVoice::Age>;
@@ -210,6 +258,16 @@ void tst_QTextToSpeech::availableVoices()
     QVERIFY(availableVoices.size() > 0);
     for (const auto &voice : availableVoices)
         qInfo().noquote() << "-" << voice;
+
+    // the voices of the locale don't depend on the voices enumerated before, e.g. they
+    // include the voices of all speech-dispatcher modules that offer the locale
+    QTextToSpeech complete(engine);
+    QTRY_COMPARE(complete.state(), QTextToSpeech::Ready);
+    QVERIFY(complete.availableLocales().contains(tts.locale()));
+    const QList<QVoice> localeVoices = complete.findVoices(tts.locale());
+    QCOMPARE(localeVoices.size(), availableVoices.size());
+    for (const auto &voice : localeVoices)
+        QVERIFY2(availableVoices.contains(voice), qPrintable(voice.name()));
 }
 
 void tst_QTextToSpeech::availableLocales()
@@ -284,6 +342,15 @@ void tst_QTextToSpeech::findVoices_data()
     QTest::addRow("from Norway") << allVoices
         << SELECTOR(QLocale::Norway)
         << QList<VoiceData>{fromOslo, fromWestcoast};
+    QTest::addRow("male senior") << allVoices
+        << SELECTOR(QVoice::Male, QVoice::Senior)
+        << QList<VoiceData>{bob, maleSenior};
+    QTest::addRow("English female") << allVoices
+        << SELECTOR(QLocale::English, QVoice::Female)
+        << QList<VoiceData>{alice, femaleTeen, femaleAdult};
+    QTest::addRow("Bob from the UK") << allVoices
+        << SELECTOR(u"Bob"_s, QLocale::UnitedKingdom)
+        << QList<VoiceData>{bob};
 
     // multiple of same type - not supported as it would always yield an empty result,
     // so we generate a compile-time error. Ideally we could logically OR those criteria,
@@ -347,6 +414,56 @@ void tst_QTextToSpeech::findVoices()
     QCOMPARE(tts.findVoices(tts.locale()), tts.availableVoices());
 }
 
+void tst_QTextToSpeech::allVoices()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    QTextToSpeech tts(engine);
+    QSignalSpy localeChangedSpy(&tts, &QTextToSpeech::localeChanged);
+    QSignalSpy voiceChangedSpy(&tts, &QTextToSpeech::voiceChanged);
+
+    // the catalog has the voices of all locales, in the order of the locales
+    const QList<QVoice> voices = tts.findVoices();
+    QCOMPARE(localeChangedSpy.count(), 0);
+    QCOMPARE(voiceChangedSpy.count(), 0);
+
+    QList<QVoice> expectedVoices;
+    for (const QLocale &locale : tts.availableLocales()) {
+        tts.setLocale(locale);
+        expectedVoices << tts.availableVoices();
+        QCOMPARE(tts.findVoices(locale), tts.availableVoices());
+    }
+    QCOMPARE(voices, expectedVoices);
+}
+
+void tst_QTextToSpeech::voicesChanged()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    const VoiceData bob = {u"Bob"_s, QLocale(QLocale::English, QLocale::UnitedKingdom),
+                           QVoice::Male, QVoice::Adult};
+    const VoiceData alice = {u"Alice"_s, QLocale(QLocale::English, QLocale::UnitedStates),
+                             QVoice::Female, QVoice::Adult};
+    QVariantMap parameters;
+    parameters["voices"] = QVariant::fromValue(QList<VoiceData>{bob});
+    // the mock engine installs the voice after a while, and emits voicesChanged
+    parameters["installedVoice"] = QVariant::fromValue(alice);
+    QTextToSpeech tts(engine, parameters);
+
+    QCOMPARE(tts.findVoices(), (QList<VoiceData>{bob}));
+    QVERIFY(tts.findVoices(u"Alice"_s).isEmpty());
+
+    // the catalog is read again from the engine
+    QTRY_COMPARE(tts.findVoices(u"Alice"_s), (QList<VoiceData>{alice}));
+    QCOMPARE(tts.findVoices().size(), 2);
+}
+
 /*
     Testing the locale property, and its dependency on the voice
     property.
@@ -1073,6 +1190,705 @@ void tst_QTextToSpeech::synthesizeCallback()
     QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
     QCOMPARE(processor.m_allBytes, expectedBytes);
     processor.reset();
+
+    // Taking a view on the data, with the start time of each chunk
+    qint64 expectedStartTime = 0;
+    tts.synthesize(text, [&](QByteArrayView data, const QAudioFormat &format, qint64 startTime) {
+        QCOMPARE(startTime, expectedStartTime);
+        expectedStartTime += format.durationForBytes(data.size());
+        processor.m_format = format;
+        processor.m_allBytes += data;
+    });
+    QTRY_COMPARE(processor.m_format, expectedFormat);
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+    QCOMPARE(processor.m_allBytes, expectedBytes);
+    QCOMPARE(expectedStartTime, expectedFormat.durationForBytes(expectedBytes.size()));
+    processor.reset();
+}
+
+void tst_QTextToSpeech::synthesisCache()
+{
+    QFETCH_GLOBAL(QString, engine);
+    if (engine != "mock")
+        QSKIP("Only testing with mock engine");
+
+    const QString text = u"Cache this text, please"_s;
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+
+    const auto synthesizeText = [&text](QTextToSpeech &tts) {
+        QByteArray bytes;
+        QStringList words;
+        auto connection = connect(&tts, &QTextToSpeech::sayingWord, &tts,
+                                  [&words](const QString &word) { words << word; });
+        tts.synthesize(text, [&bytes](const QAudioFormat &, const QByteArray &data) {
+            bytes += data;
+        });
+        [&]{ QTRY_COMPARE(tts.state(), QTextToSpeech::Ready); }();
+        disconnect(connection);
+        return std::make_pair(bytes, words);
+    };
+
+    QTextToSpeech tts(engine);
+    QCOMPARE(tts.cacheCapacity(), qsizetype(0));
+    const auto reference = synthesizeText(tts);
+    QVERIFY(!reference.first.isEmpty());
+    QCOMPARE(reference.second.size(), 4);
+    // the cache is disabled by default
+    QCOMPARE(tts.cacheHits(), qint64(0));
+    QCOMPARE(tts.cacheMisses(), qint64(0));
+
+    tts.setCacheCapacity(1024 * 1024);
+    tts.setCacheDirectory(cacheDir.path());
+    QCOMPARE(synthesizeText(tts), reference);
+    QCOMPARE(tts.cacheHits(), qint64(0));
+    QCOMPARE(tts.cacheMisses(), qint64(1));
+
+    // the second time, data and words come from the cache
+    QCOMPARE(synthesizeText(tts), reference);
+    QCOMPARE(tts.cacheHits(), qint64(1));
+    QCOMPARE(tts.cacheMisses(), qint64(1));
+
+    // changing any attribute of the synthesis misses the cache
+    tts.setRate(0.5);
+    synthesizeText(tts);
+    QCOMPARE(tts.cacheHits(), qint64(1));
+    QCOMPARE(tts.cacheMisses(), qint64(2));
+    tts.setRate(0.0);
+
+    // a new instance finds the entries in the directory
+    {
+        QTextToSpeech other(engine);
+        other.setCacheDirectory(cacheDir.path());
+        QCOMPARE(synthesizeText(other), reference);
+        QCOMPARE(other.cacheHits(), qint64(1));
+        QCOMPARE(other.cacheMisses(), qint64(0));
+    }
+
+    tts.clearCache();
+    QCOMPARE(synthesizeText(tts), reference);
+    QCOMPARE(tts.cacheHits(), qint64(1));
+    QCOMPARE(tts.cacheMisses(), qint64(3));
+}
+
+void tst_QTextToSpeech::synthesizeBatch_data()
+{
+    QTest::addColumn<bool>("useCache");
+
+    QTest::addRow("engine") << false;
+    QTest::addRow("queue") << true;
+}
+
+void tst_QTextToSpeech::synthesizeBatch()
+{
+    QFETCH_GLOBAL(QString, engine);
+    if (engine != "mock")
+        QSKIP("Only testing with mock engine");
+    QFETCH(bool, useCache);
+
+    const QStringList texts = {u"First text"_s, u"Second"_s, u"The third text"_s};
+
+    QTextToSpeech tts(engine);
+    // the cache needs each text individually, so the batch goes through the queue
+    if (useCache)
+        tts.setCacheCapacity(1024 * 1024);
+
+    // reference data for each text
+    QList<QByteArray> expectedBytes;
+    for (const auto &text : texts) {
+        QByteArray bytes;
+        tts.synthesize(text, [&bytes](const QAudioFormat &, const QByteArray &data) {
+            bytes += data;
+        });
+        QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+        expectedBytes << bytes;
+    }
+
+    QList<QByteArray> batchBytes(texts.size());
+    QList<qsizetype> finished;
+    QSignalSpy stateSpy(&tts, &QTextToSpeech::stateChanged);
+    connect(&tts, &QTextToSpeech::utteranceSynthesized, this,
+            [&finished, &batchBytes](qsizetype id) {
+        // all data of a text is delivered before the text is finished
+        QVERIFY(!batchBytes.at(id).isEmpty());
+        finished << id;
+    });
+    tts.synthesizeBatch(texts, [&](qsizetype id, const QAudioFormat &, const QByteArray &data) {
+        // data is delivered in order
+        QCOMPARE(finished.size(), id);
+        batchBytes[id] += data;
+    });
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+
+    QCOMPARE(finished, (QList<qsizetype>{0, 1, 2}));
+    QCOMPARE(batchBytes, expectedBytes);
+    // no transition to Ready between the texts
+    QCOMPARE(stateSpy.size(), 2);
+    QCOMPARE(stateSpy.at(0).at(0).value<QTextToSpeech::State>(), QTextToSpeech::Synthesizing);
+    QCOMPARE(stateSpy.at(1).at(0).value<QTextToSpeech::State>(), QTextToSpeech::Ready);
+    if (useCache)
+        QCOMPARE(tts.cacheHits(), qint64(texts.size()));
+}
+
+void tst_QTextToSpeech::synthesizeToFile_data()
+{
+    QTest::addColumn<QTextToSpeech::FileFormat>("format");
+
+    QTest::addRow("raw") << QTextToSpeech::FileFormat::Raw;
+    QTest::addRow("wav") << QTextToSpeech::FileFormat::Wav;
+    QTest::addRow("cues") << QTextToSpeech::FileFormat::WavWithCuePoints;
+}
+
+void tst_QTextToSpeech::synthesizeToFile()
+{
+    QFETCH_GLOBAL(QString, engine);
+    if (engine != "mock")
+        QSKIP("Only testing with mock engine");
+    QFETCH(QTextToSpeech::FileFormat, format);
+
+    const QString text = u"Write this to a file"_s;
+    QTextToSpeech tts(engine);
+
+    QAudioFormat expectedFormat;
+    QByteArray expectedBytes;
+    tts.synthesize(text, [&](const QAudioFormat &format, const QByteArray &bytes) {
+        expectedFormat = format;
+        expectedBytes += bytes;
+    });
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(tts.synthesizeToFile(text, &buffer, format));
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+    const QByteArray file = buffer.data();
+
+    // a file that can't be opened fails right away
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("can't open"));
+    QVERIFY(!tts.synthesizeToFile(text, u"/nonexistent/directory/file.wav"_s, format));
+    QCOMPARE(tts.state(), QTextToSpeech::Ready);
+
+    if (format == QTextToSpeech::FileFormat::Raw) {
+        QCOMPARE(file, expectedBytes);
+        return;
+    }
+
+    const auto readUInt32 = [&file](qsizetype pos) {
+        return qFromLittleEndian<quint32>(file.constData() + pos);
+    };
+    const auto readUInt16 = [&file](qsizetype pos) {
+        return qFromLittleEndian<quint16>(file.constData() + pos);
+    };
+    QVERIFY(file.startsWith("RIFF"));
+    QCOMPARE(readUInt32(4), quint32(file.size() - 8));
+    QCOMPARE(file.sliced(8, 8), QByteArray("WAVEfmt "));
+    QCOMPARE(readUInt16(20), quint16(1));
+    QCOMPARE(readUInt16(22), quint16(expectedFormat.channelCount()));
+    QCOMPARE(readUInt32(24), quint32(expectedFormat.sampleRate()));
+    QCOMPARE(readUInt16(34), quint16(expectedFormat.bytesPerSample() * 8));
+    QCOMPARE(file.sliced(36, 4), QByteArray("data"));
+    QCOMPARE(readUInt32(40), quint32(expectedBytes.size()));
+    QCOMPARE(file.sliced(44, expectedBytes.size()), expectedBytes);
+
+    const QByteArray trailer = file.sliced(44 + expectedBytes.size());
+    if (format == QTextToSpeech::FileFormat::Wav) {
+        QVERIFY(trailer.isEmpty());
+        return;
+    }
+
+    // one cue point and label per word, at the start of each word's data
+    QVERIFY(trailer.startsWith("cue "));
+    const quint32 cueCount = qFromLittleEndian<quint32>(trailer.constData() + 8);
+    QCOMPARE(cueCount, quint32(5));
+    const qint64 framesPerWord = expectedFormat.framesForBytes(expectedBytes.size()) / cueCount;
+    for (quint32 i = 0; i < cueCount; ++i) {
+        const char *cue = trailer.constData() + 12 + i * 24;
+        QCOMPARE(qFromLittleEndian<quint32>(cue), i + 1);
+        QCOMPARE(qFromLittleEndian<quint32>(cue + 20), quint32(i * framesPerWord));
+    }
+    QVERIFY(trailer.contains("LIST"));
+    QVERIFY(trailer.contains("adtl"));
+    for (const auto &word : text.split(u' '))
+        QVERIFY(trailer.contains(word.toUtf8() + '\0'));
+}
+
+void tst_QTextToSpeech::synthesizeToFileWithCuePoints()
+{
+    QFETCH_GLOBAL(QString, engine);
+    // other engines might only report words while speaking
+    if (engine != "mock" && engine != "flite")
+        QSKIP("Only testing with engines that report words while synthesizing");
+
+    QTextToSpeech tts(engine);
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+    selectWorkingVoice(&tts);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QVERIFY(tts.synthesizeToFile(u"Hello World"_s, &buffer,
+                                 QTextToSpeech::FileFormat::WavWithCuePoints));
+    QTRY_COMPARE_WITH_TIMEOUT(tts.state(), QTextToSpeech::Ready, SpeechDuration);
+    const QByteArray file = buffer.data();
+    const auto readUInt32 = [&file](qsizetype pos) {
+        return qFromLittleEndian<quint32>(file.constData() + pos);
+    };
+
+    // a cue point for each word follows the data chunk
+    QVERIFY(file.startsWith("RIFF"));
+    quint32 cueCount = 0;
+    for (qsizetype pos = 12; pos + 8 <= file.size();) {
+        const quint32 size = readUInt32(pos + 4);
+        if (file.sliced(pos, 4) == "cue ")
+            cueCount = readUInt32(pos + 8);
+        pos += 8 + size + size % 2;
+    }
+    QCOMPARE(cueCount, quint32(2));
+}
+
+void tst_QTextToSpeech::floatWavFile()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    QAudioFormat format;
+    format.setSampleRate(22050);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Float);
+    const QByteArray data(format.bytesForFrames(100), '\x01');
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    {
+        QTextToSpeechFileWriter writer(&buffer, QTextToSpeech::FileFormat::Wav);
+        QVERIFY(writer.open());
+        QVERIFY(writer.write(format, data));
+    }
+    const QByteArray file = buffer.data();
+    const auto readUInt32 = [&file](qsizetype pos) {
+        return qFromLittleEndian<quint32>(file.constData() + pos);
+    };
+    const auto readUInt16 = [&file](qsizetype pos) {
+        return qFromLittleEndian<quint16>(file.constData() + pos);
+    };
+
+    // WAVE_FORMAT_IEEE_FLOAT, with an empty extension and a fact chunk
+    QCOMPARE(readUInt32(4), quint32(file.size() - 8));
+    QCOMPARE(file.sliced(12, 4), QByteArray("fmt "));
+    QCOMPARE(readUInt32(16), quint32(18));
+    QCOMPARE(readUInt16(20), quint16(3));
+    QCOMPARE(readUInt16(34), quint16(32));
+    QCOMPARE(readUInt16(36), quint16(0));
+    QCOMPARE(file.sliced(38, 4), QByteArray("fact"));
+    QCOMPARE(readUInt32(42), quint32(4));
+    QCOMPARE(readUInt32(46), quint32(100));
+    QCOMPARE(file.sliced(50, 4), QByteArray("data"));
+    QCOMPARE(readUInt32(54), quint32(data.size()));
+    QCOMPARE(file.sliced(58), data);
+}
+
+void tst_QTextToSpeech::sequentialWavFile()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    QAudioFormat format;
+    format.setSampleRate(22050);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::UInt8);
+    const QByteArray data(format.bytesForFrames(99), '\x01');
+
+    SequentialDevice device;
+    QVERIFY(device.open(QIODevice::WriteOnly));
+    {
+        QTextToSpeechFileWriter writer(&device, QTextToSpeech::FileFormat::WavWithCuePoints);
+        QVERIFY(writer.open());
+        writer.addCuePoint(u"first"_s);
+        QVERIFY(writer.write(format, data));
+        writer.addCuePoint(u"second"_s);
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("can't write cue points"));
+        writer.finish();
+    }
+    const QByteArray file = device.written;
+    const auto readUInt32 = [&file](qsizetype pos) {
+        return qFromLittleEndian<quint32>(file.constData() + pos);
+    };
+
+    // the sizes stay at the maximum, so neither padding nor cue points follow the data
+    QCOMPARE(readUInt32(4), std::numeric_limits<quint32>::max());
+    QCOMPARE(file.sliced(36, 4), QByteArray("data"));
+    QCOMPARE(readUInt32(40), std::numeric_limits<quint32>::max());
+    QCOMPARE(file.sliced(44), data);
+}
+
+void tst_QTextToSpeech::statistics()
+{
+    QFETCH_GLOBAL(QString, engine);
+    if (engine != "mock")
+        QSKIP("Only testing with mock engine");
+
+    QTextToSpeech tts(engine);
+    QSignalSpy spy(&tts, &QTextToSpeech::statisticsAvailable);
+    const auto statisticsAt = [&spy](qsizetype index) {
+        return spy.at(index).at(0).value<QTextToSpeechStatistics>();
+    };
+
+    // the mock engine produces 100ms of audio for each word
+    tts.enqueue(u"Two words"_s);
+    tts.enqueue(u"Three more words"_s);
+    QTRY_COMPARE(spy.size(), 2);
+    QCOMPARE(tts.state(), QTextToSpeech::Ready);
+    for (qsizetype i = 0; i < spy.size(); ++i) {
+        const QTextToSpeechStatistics statistics = statisticsAt(i);
+        QCOMPARE(statistics.id(), i);
+        QCOMPARE(statistics.chunkCount(), i + 2);
+        QCOMPARE(statistics.audioDuration(), qint64((i + 2) * 100000));
+        QVERIFY(statistics.speakingTime() >= 0);
+        QVERIFY(statistics.firstAudioTime() >= statistics.speakingTime());
+        QVERIFY(statistics.synthesisTime() >= statistics.firstAudioTime());
+        QVERIFY(statistics.totalTime() >= statistics.synthesisTime());
+        QVERIFY(statistics.realTimeFactor() > 0);
+    }
+
+    spy.clear();
+    qint64 byteCount = 0;
+    tts.synthesize(u"Synthesize this"_s, [&byteCount](const QAudioFormat &, const QByteArray &bytes) {
+        byteCount += bytes.size();
+    });
+    QTRY_COMPARE(spy.size(), 1);
+    QCOMPARE(statisticsAt(0).speakingTime(), qint64(-1));
+    QCOMPARE(statisticsAt(0).chunkCount(), qsizetype(2));
+    QCOMPARE(statisticsAt(0).byteCount(), byteCount);
+
+    // stopping reports what has been processed so far
+    spy.clear();
+    tts.say(u"This will not be finished"_s);
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Speaking);
+    tts.stop();
+    QTRY_COMPARE(spy.size(), 1);
+    QVERIFY(statisticsAt(0).chunkCount() < 5);
+}
+
+void tst_QTextToSpeech::asynchronousInitialization()
+{
+    QFETCH_GLOBAL(QString, engine);
+    if (engine != "mock")
+        QSKIP("Only testing with mock engine");
+
+    QTextToSpeech tts(engine, {{u"initializeAsynchronously"_s, true}});
+    QCOMPARE(tts.state(), QTextToSpeech::Initializing);
+    QCOMPARE(tts.engine(), engine);
+
+    QSignalSpy aboutToSynthesizeSpy(&tts, &QTextToSpeech::aboutToSynthesize);
+    // texts and attributes set while initializing are applied once ready
+    tts.setRate(0.5);
+    tts.say(u"Hello"_s);
+    QCOMPARE(tts.enqueue(u"World"_s), 1);
+    QCOMPARE(tts.state(), QTextToSpeech::Initializing);
+
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Speaking);
+    QCOMPARE(tts.rate(), 0.5);
+    QVERIFY(!tts.availableVoices().isEmpty());
+    QTRY_COMPARE(tts.state(), QTextToSpeech::Ready);
+    QCOMPARE(aboutToSynthesizeSpy.size(), 2);
+
+    // without the parameter, the engine is ready right away
+    QVERIFY(tts.setEngine(engine, {{u"initializeAsynchronously"_s, false}}));
+    QCOMPARE(tts.state(), QTextToSpeech::Ready);
+}
+
+void tst_QTextToSpeech::sharedEngine()
+{
+    QFETCH_GLOBAL(QString, engine);
+    if (engine != "mock")
+        QSKIP("Only testing with mock engine");
+
+    const QVariantMap parameters{{u"sharedEngine"_s, true}, {u"wordInterval"_s, 10}};
+    QTextToSpeech first(engine, parameters);
+    QTextToSpeech second(engine, parameters);
+    QCOMPARE(first.state(), QTextToSpeech::Ready);
+    QCOMPARE(second.state(), QTextToSpeech::Ready);
+
+    // each object keeps its own attributes
+    first.setRate(0.5);
+    second.setRate(-0.5);
+    QCOMPARE(first.rate(), 0.5);
+    QCOMPARE(second.rate(), -0.5);
+
+    QStringList words;
+    connect(&first, &QTextToSpeech::sayingWord, this, [&words](const QString &word) {
+        words << word;
+    });
+    connect(&second, &QTextToSpeech::sayingWord, this, [&words](const QString &word) {
+        words << word;
+    });
+
+    // the objects take turns, and wait while the other one speaks
+    first.enqueue(u"one"_s);
+    first.enqueue(u"two"_s);
+    first.enqueue(u"three"_s);
+    second.enqueue(u"four"_s);
+    QCOMPARE(first.state(), QTextToSpeech::Speaking);
+    QCOMPARE(second.state(), QTextToSpeech::Speaking);
+    QTRY_COMPARE(first.state(), QTextToSpeech::Ready);
+    QCOMPARE(second.state(), QTextToSpeech::Ready);
+    QCOMPARE(words, (QStringList{u"one"_s, u"four"_s, u"two"_s, u"three"_s}));
+    QCOMPARE(first.rate(), 0.5);
+    QCOMPARE(second.rate(), -0.5);
+
+    // new objects don't inherit the attributes of the object that spoke last
+    {
+        QTextToSpeech third(engine, parameters);
+        QCOMPARE(third.rate(), 0.0);
+        QCOMPARE(third.volume(), 0.5);
+    }
+
+    // stopping a text that waits for its turn
+    words.clear();
+    first.say(u"five"_s);
+    second.say(u"six"_s);
+    second.stop();
+    QCOMPARE(second.state(), QTextToSpeech::Ready);
+    QTRY_COMPARE(first.state(), QTextToSpeech::Ready);
+    QCOMPARE(words, QStringList{u"five"_s});
+
+    // destroying the object that speaks starts the waiting text only once the
+    // engine has reported the end of the stopped text
+    QVariantMap stopParameters = parameters;
+    stopParameters.insert(u"asynchronousStop"_s, true);
+    auto speaking = std::make_unique<QTextToSpeech>(engine, stopParameters);
+    QTextToSpeech waiting(engine, stopParameters);
+    words.clear();
+    connect(&waiting, &QTextToSpeech::sayingWord, this, [&words](const QString &word) {
+        words << word;
+    });
+    speaking->say(u"seven eight nine"_s);
+    waiting.say(u"ten"_s);
+    QCOMPARE(waiting.state(), QTextToSpeech::Speaking);
+    speaking.reset();
+    QCOMPARE(waiting.state(), QTextToSpeech::Speaking);
+    QTRY_COMPARE(waiting.state(), QTextToSpeech::Ready);
+    QCOMPARE(words, QStringList{u"ten"_s});
+}
+
+namespace {
+QAudioFormat audioFormat(int sampleRate, int channelCount, QAudioFormat::SampleFormat sampleFormat)
+{
+    QAudioFormat format;
+    format.setSampleRate(sampleRate);
+    format.setChannelCount(channelCount);
+    format.setSampleFormat(sampleFormat);
+    return format;
+}
+}
+
+void tst_QTextToSpeech::audioConverter_data()
+{
+    QTest::addColumn<QAudioFormat>("inputFormat");
+    QTest::addColumn<QAudioFormat>("outputFormat");
+
+    QTest::addRow("channels") << audioFormat(16000, 1, QAudioFormat::Int16)
+                              << audioFormat(16000, 2, QAudioFormat::Int16);
+    QTest::addRow("upsampling") << audioFormat(16000, 1, QAudioFormat::Int16)
+                                << audioFormat(48000, 2, QAudioFormat::Float);
+    QTest::addRow("downsampling") << audioFormat(48000, 2, QAudioFormat::Float)
+                                  << audioFormat(16000, 1, QAudioFormat::Int16);
+    QTest::addRow("fractional") << audioFormat(16000, 1, QAudioFormat::Int16)
+                                << audioFormat(44100, 1, QAudioFormat::Int32);
+}
+
+// Converts a sine wave in chunks, and compares the result with the same sine
+// wave generated in the output format
+void tst_QTextToSpeech::audioConverter()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    QFETCH(const QAudioFormat, inputFormat);
+    QFETCH(const QAudioFormat, outputFormat);
+
+    constexpr double frequency = 440;
+    constexpr double amplitude = 0.5;
+    const auto sine = [&](qint64 frame, int sampleRate) {
+        return amplitude * std::sin(2 * M_PI * frequency * frame / sampleRate);
+    };
+
+    const qint64 inputFrames = inputFormat.framesForDuration(100000);
+    QByteArray input(inputFormat.bytesForFrames(inputFrames), Qt::Uninitialized);
+    for (qint64 frame = 0; frame < inputFrames; ++frame) {
+        for (int channel = 0; channel < inputFormat.channelCount(); ++channel) {
+            char *sample = input.data() + inputFormat.bytesForFrames(frame)
+                         + channel * inputFormat.bytesPerSample();
+            const double value = sine(frame, inputFormat.sampleRate());
+            if (inputFormat.sampleFormat() == QAudioFormat::Float)
+                *reinterpret_cast<float *>(sample) = float(value);
+            else
+                *reinterpret_cast<qint16 *>(sample) = qint16(qRound(value * 32767));
+        }
+    }
+
+    QTextToSpeechAudioConverter converter(inputFormat, outputFormat);
+    QVERIFY(converter.isValid());
+    QByteArray output;
+    QByteArray chunk;
+    const qint64 chunkSize = inputFormat.bytesForFrames(160);
+    for (qint64 offset = 0; offset < input.size(); offset += chunkSize) {
+        const qint64 size = qMin(chunkSize, input.size() - offset);
+        converter.convert(QByteArrayView(input).sliced(offset, size), chunk,
+                          offset + size == input.size());
+        output += chunk;
+    }
+
+    const qint64 outputFrames = outputFormat.framesForBytes(output.size());
+    const qint64 expectedFrames = outputFormat.framesForDuration(100000);
+    QVERIFY2(qAbs(outputFrames - expectedFrames) <= 4,
+             qPrintable(u"%1 frames instead of %2"_s.arg(outputFrames).arg(expectedFrames)));
+    // the edges are distorted by the filter
+    for (qint64 frame = outputFrames / 4; frame < outputFrames * 3 / 4; ++frame) {
+        const double expected = sine(frame, outputFormat.sampleRate());
+        for (int channel = 0; channel < outputFormat.channelCount(); ++channel) {
+            const char *sample = output.constData() + outputFormat.bytesForFrames(frame)
+                               + channel * outputFormat.bytesPerSample();
+            const double value = outputFormat.normalizedSampleValue(sample);
+            QVERIFY2(qAbs(value - expected) < 0.005,
+                     qPrintable(u"frame %1, channel %2: %3 instead of %4"_s.arg(frame)
+                                .arg(channel).arg(value).arg(expected)));
+        }
+    }
+}
+
+void tst_QTextToSpeech::processingChain()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    // silence around a square wave at a quarter of full scale
+    QList<qint16> samples(100, 0);
+    for (int i = 0; i < 200; ++i)
+        samples.append(i % 2 ? -8192 : 8192);
+    samples.append(QList<qint16>(100, 0));
+
+    int calls = 0;
+    QTextToSpeechProcessingChain chain;
+    chain.append(QTextToSpeechProcessingChain::trimSilence(0.01));
+    chain.append(QTextToSpeechProcessingChain::normalize(0.5));
+    chain.append([&calls](QTextToSpeechProcessingChain::Chunk &) { ++calls; });
+    QVERIFY(!chain.isEmpty());
+
+    const auto process = [&samples](QTextToSpeechProcessingChain &chain, qsizetype offset,
+                                     qsizetype count, bool first, bool last) {
+        QTextToSpeechProcessingChain::Chunk chunk;
+        chunk.format.setSampleFormat(QAudioFormat::Int16);
+        chunk.format.setSampleRate(16000);
+        chunk.format.setChannelCount(1);
+        chunk.data = reinterpret_cast<char *>(samples.data() + offset);
+        chunk.size = count * qsizetype(sizeof(qint16));
+        chunk.first = first;
+        chunk.last = last;
+        chain.process(chunk);
+        return QList<qint16>(reinterpret_cast<const qint16 *>(chunk.data),
+                             reinterpret_cast<const qint16 *>(chunk.data + chunk.size));
+    };
+
+    // the first chunk is silent, the last chunk ends with silence
+    QVERIFY(process(chain, 0, 50, true, false).isEmpty());
+    QCOMPARE(calls, 1);
+    const QList<qint16> middle = process(chain, 50, 200, false, false);
+    QCOMPARE(middle.size(), 150);
+    QCOMPARE(middle.first(), 16384);
+    QCOMPARE(middle.last(), -16384);
+    const QList<qint16> end = process(chain, 250, 150, false, true);
+    QCOMPARE(end.size(), 50);
+    QCOMPARE(calls, 3);
+
+    // the samples have been normalized in place; amplifying them saturates
+    QTextToSpeechProcessingChain gain;
+    gain.append(QTextToSpeechProcessingChain::gain(4));
+    QList<qint16> saturated;
+    for (int i = 0; i < 16; ++i)
+        saturated.append(i % 2 ? -32768 : 32767);
+    QCOMPARE(process(gain, 100, 16, true, true), saturated);
+}
+
+void tst_QTextToSpeech::timeStretcher_data()
+{
+    QTest::addColumn<QAudioFormat>("format");
+    QTest::addColumn<double>("speed");
+
+    QTest::addRow("unchanged") << audioFormat(16000, 1, QAudioFormat::Int16) << 1.0;
+    QTest::addRow("faster") << audioFormat(16000, 1, QAudioFormat::Int16) << 2.0;
+    QTest::addRow("slower") << audioFormat(16000, 1, QAudioFormat::Int16) << 0.5;
+    QTest::addRow("stereo") << audioFormat(48000, 2, QAudioFormat::Float) << 1.5;
+}
+
+// Stretches a sine wave in chunks, which changes its duration, but not its frequency
+void tst_QTextToSpeech::timeStretcher()
+{
+    QFETCH_GLOBAL(const QString, engine);
+    // Testing once with mock engine is enough, no need to generate QSKIP noise
+    if (engine != "mock")
+        return;
+
+    QFETCH(const QAudioFormat, format);
+    QFETCH(const double, speed);
+
+    constexpr double frequency = 200;
+    const qint64 inputFrames = format.framesForDuration(1000000);
+    QByteArray input(format.bytesForFrames(inputFrames), Qt::Uninitialized);
+    for (qint64 frame = 0; frame < inputFrames; ++frame) {
+        const double value = 0.5 * std::sin(2 * M_PI * frequency * frame / format.sampleRate());
+        for (int channel = 0; channel < format.channelCount(); ++channel) {
+            char *sample = input.data() + format.bytesForFrames(frame)
+                         + channel * format.bytesPerSample();
+            if (format.sampleFormat() == QAudioFormat::Float)
+                *reinterpret_cast<float *>(sample) = float(value);
+            else
+                *reinterpret_cast<qint16 *>(sample) = qint16(qRound(value * 32767));
+        }
+    }
+
+    QTextToSpeechTimeStretcher stretcher(format);
+    QVERIFY(stretcher.isValid());
+    stretcher.setSpeed(speed);
+    QByteArray output;
+    QByteArray chunk;
+    const qint64 chunkSize = format.bytesForDuration(10000);
+    for (qint64 offset = 0; offset < input.size(); offset += chunkSize) {
+        const qint64 size = qMin(chunkSize, input.size() - offset);
+        stretcher.process(QByteArrayView(input).sliced(offset, size), chunk,
+                          offset + size == input.size());
+        output += chunk;
+    }
+
+    if (speed == 1) {
+        QCOMPARE(output, input);
+        return;
+    }
+
+    const qint64 outputFrames = format.framesForBytes(output.size());
+    const qint64 expectedFrames = qRound64(inputFrames / speed);
+    QVERIFY2(qAbs(outputFrames - expectedFrames) <= format.framesForDuration(20000),
+             qPrintable(u"%1 frames instead of %2"_s.arg(outputFrames).arg(expectedFrames)));
+
+    qint64 zeroCrossings = 0;
+    double previous = 0;
+    for (qint64 frame = 0; frame < outputFrames; ++frame) {
+        const double value = format.normalizedSampleValue(output.constData()
+                                                          + format.bytesForFrames(frame));
+        if (frame > 0 && (value < 0) != (previous < 0))
+            ++zeroCrossings;
+        previous = value;
+    }
+    const double measuredFrequency = zeroCrossings / 2.0 * format.sampleRate() / outputFrames;
+    QVERIFY2(qAbs(measuredFrequency - frequency) < frequency * 0.05,
+             qPrintable(u"%1 Hz instead of %2 Hz"_s.arg(measuredFrequency).arg(frequency)));
 }
 
 QTEST_MAIN(tst_QTextToSpeech)
@@ -0,0 +1,256 @@
+// Copyright (C) 2025 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QTest>
+#include <QTextToSpeech>
+#include <QEventLoop>
+#include <QTimer>
+#include <QAudioFormat>
+#include <QAudioBuffer>
+
+using namespace Qt::StringLiterals;
+
+namespace {
+// The mock engine takes 100ms per word by default; without delay, the
+// benchmarks measure the overhead of QTextToSpeech and the event loop.
+QVariantMap mockParameters()
+{
+    return {{u"wordInterval"_s, 0}};
+}
+
+QString words(qsizetype count)
+{
+    QStringList list;
+    list.reserve(count);
+    for (qsizetype i = 0; i < count; ++i)
+        list << u"word"_s;
+    return list.join(u' ');
+}
+
+using VoiceData = std::tuple<QString, QLocale, QVoice::Gender, QVoice::Age>;
+
+// Voices with unique names, spread over several locales, genders and ages
+QList<VoiceData> voicesData(qsizetype count)
+{
+    static const QList<QLocale> locales = {
+        QLocale(QLocale::English, QLocale::UnitedKingdom),
+        QLocale(QLocale::English, QLocale::UnitedStates),
+        QLocale(QLocale::German, QLocale::Germany),
+        QLocale(QLocale::German, QLocale::Austria),
+        QLocale(QLocale::French, QLocale::France),
+        QLocale(QLocale::French, QLocale::Canada),
+        QLocale(QLocale::NorwegianBokmal, QLocale::Norway),
+        QLocale(QLocale::Japanese, QLocale::Japan),
+    };
+    static const QList<QVoice::Age> ages = {
+        QVoice::Child, QVoice::Teenager, QVoice::Adult, QVoice::Senior, QVoice::Other
+    };
+    static const QList<QVoice::Gender> genders = {
+        QVoice::Male, QVoice::Female, QVoice::Unknown
+    };
+
+    QList<VoiceData> voices;
+    voices.reserve(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        voices.append({u"Voice %1"_s.arg(i), locales.at(i % locales.size()),
+                       genders.at(i % genders.size()), ages.at(i % ages.size())});
+    }
+    return voices;
+}
+
+bool waitForState(QTextToSpeech &tts, QTextToSpeech::State state)
+{
+    if (tts.state() == state)
+        return true;
+    QEventLoop loop;
+    QObject::connect(&tts, &QTextToSpeech::stateChanged,
+                     &loop, [&loop, state](QTextToSpeech::State newState) {
+        if (newState == state)
+            loop.quit();
+    });
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    loop.exec();
+    return tts.state() == state;
+}
+}
+
+class tst_QTextToSpeechBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void enqueue_data();
+    void enqueue();
+    void say();
+    void queueTransitions_data();
+    void queueTransitions();
+    void synthesizeCallback_data();
+    void synthesizeCallback();
+    void stop();
+    void pauseResume();
+    void findVoices_data();
+    void findVoices();
+};
+
+void tst_QTextToSpeechBenchmark::initTestCase()
+{
+    if (!QTextToSpeech::availableEngines().contains(u"mock"_s))
+        QSKIP("The mock engine is not available");
+}
+
+void tst_QTextToSpeechBenchmark::enqueue_data()
+{
+    QTest::addColumn<qsizetype>("count");
+
+    QTest::addRow("10") << qsizetype(10);
+    QTest::addRow("100") << qsizetype(100);
+    QTest::addRow("1000") << qsizetype(1000);
+}
+
+// Adding texts to the queue while the engine is speaking
+void tst_QTextToSpeechBenchmark::enqueue()
+{
+    QFETCH(qsizetype, count);
+
+    QTextToSpeech tts(u"mock"_s);
+    const QString text = words(10);
+    QBENCHMARK {
+        tts.say(text);
+        for (qsizetype i = 0; i < count; ++i)
+            tts.enqueue(text);
+    }
+    tts.stop();
+}
+
+void tst_QTextToSpeechBenchmark::say()
+{
+    QTextToSpeech tts(u"mock"_s);
+    const QString text = words(10);
+    QBENCHMARK {
+        tts.say(text);
+    }
+    tts.stop();
+}
+
+void tst_QTextToSpeechBenchmark::queueTransitions_data()
+{
+    QTest::addColumn<qsizetype>("count");
+
+    QTest::addRow("10") << qsizetype(10);
+    QTest::addRow("100") << qsizetype(100);
+}
+
+// Moving on to the next text in the queue when the engine becomes ready
+void tst_QTextToSpeechBenchmark::queueTransitions()
+{
+    QFETCH(qsizetype, count);
+
+    QTextToSpeech tts(u"mock"_s, mockParameters());
+    const QString text = words(1);
+    QBENCHMARK {
+        for (qsizetype i = 0; i < count; ++i)
+            tts.enqueue(text);
+        QVERIFY(waitForState(tts, QTextToSpeech::Ready));
+    }
+}
+
+void tst_QTextToSpeechBenchmark::synthesizeCallback_data()
+{
+    QTest::addColumn<bool>("audioBuffer");
+
+    QTest::addRow("format, bytes") << false;
+    QTest::addRow("audio buffer") << true;
+}
+
+// Delivering the data of 100 words to the functor passed to synthesize()
+void tst_QTextToSpeechBenchmark::synthesizeCallback()
+{
+    QFETCH(bool, audioBuffer);
+
+    QTextToSpeech tts(u"mock"_s, mockParameters());
+    const QString text = words(100);
+    qint64 bytesReceived = 0;
+    QBENCHMARK {
+        if (audioBuffer) {
+            tts.synthesize(text, this, [&bytesReceived](const QAudioBuffer &buffer) {
+                bytesReceived += buffer.byteCount();
+            });
+        } else {
+            tts.synthesize(text, this, [&bytesReceived](const QAudioFormat &,
+                                                        const QByteArray &bytes) {
+                bytesReceived += bytes.size();
+            });
+        }
+        QVERIFY(waitForState(tts, QTextToSpeech::Ready));
+    }
+    QVERIFY(bytesReceived > 0);
+}
+
+void tst_QTextToSpeechBenchmark::stop()
+{
+    QTextToSpeech tts(u"mock"_s, mockParameters());
+    const QString text = words(10);
+    QBENCHMARK {
+        tts.say(text);
+        tts.stop();
+        QVERIFY(waitForState(tts, QTextToSpeech::Ready));
+    }
+}
+
+// The mock engine pauses at the end of the current word
+void tst_QTextToSpeechBenchmark::pauseResume()
+{
+    QTextToSpeech tts(u"mock"_s, mockParameters());
+    const QString text = words(1000);
+    QBENCHMARK {
+        if (tts.state() != QTextToSpeech::Speaking)
+            tts.say(text);
+        tts.pause();
+        QVERIFY(waitForState(tts, QTextToSpeech::Paused));
+        tts.resume();
+        QVERIFY(waitForState(tts, QTextToSpeech::Speaking));
+    }
+    tts.stop();
+}
+
+void tst_QTextToSpeechBenchmark::findVoices_data()
+{
+    QTest::addColumn<qsizetype>("count");
+    QTest::addColumn<bool>("byName");
+
+    for (qsizetype count : {100, 1000, 10000, 20000}) {
+        QTest::addRow("name, %lld", qlonglong(count)) << count << true;
+        QTest::addRow("locale and age, %lld", qlonglong(count)) << count << false;
+    }
+}
+
+// Looking up voices by criteria; the cost of looking up a voice by name
+// should not depend on the number of voices, while looking up voices by locale
+// and age depends on the number of matching voices.
+void tst_QTextToSpeechBenchmark::findVoices()
+{
+    QFETCH(qsizetype, count);
+    QFETCH(bool, byName);
+
+    QVariantMap parameters = mockParameters();
+    parameters[u"voices"_s] = QVariant::fromValue(voicesData(count));
+    QTextToSpeech tts(u"mock"_s, parameters);
+    // reads the voices from the engine
+    QCOMPARE(tts.findVoices().size(), count);
+
+    const QString name = u"Voice %1"_s.arg(count / 2);
+    const QLocale locale(QLocale::German, QLocale::Austria);
+    qsizetype found = 0;
+    QBENCHMARK {
+        if (byName)
+            found = tts.findVoices(name).size();
+        else
+            found = tts.findVoices(locale, QVoice::Senior).size();
+    }
+    QVERIFY(found > 0);
+}
+
+QTEST_MAIN(tst_QTextToSpeechBenchmark)
+#include "tst_bench_qtexttospeech.moc"